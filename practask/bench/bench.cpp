@@ -0,0 +1,1008 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    bench.cpp
+
+Abstract:
+
+    Benchmarks.
+
+    Usage:
+        ./bin/bench [filter]
+
+    Runs every benchmark whose name contains filter (all by default).
+    Build with optimizations (OPT in CMakeLists.txt) before measuring.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <BottomUp.h>
+#include <Ast.h>
+#include <Compiled.h>
+#include <Determinize.h>
+#include <Nfa.h>
+#include <Optimize.h>
+#include <PatternSet.h>
+#include <Planner.h>
+#include <Regexp.h>
+#include <Runs.h>
+#include <Tables.h>
+#include <Task.h>
+#include <WordIndex.h>
+#include "Pipelines.h"
+
+//
+// Definitions
+//
+
+// ******************************************************
+//                       Harness
+// ******************************************************
+
+AlphabetType const Abc = { 'a', 'b', 'c' };
+
+std::string const FirstRegexp  = "ab+c.aba.*.bac.+.+*1+";
+std::string const SecondRegexp = "acb..bab.c.*.ab.ba.+.+*a.";
+
+std::string RandomWord(std::string const& Symbols, size_t Length, unsigned Seed = 13)
+{
+    std::mt19937 rng(Seed);
+    std::string word(Length, '\0');
+    for (auto& sym : word)
+        sym = Symbols[rng() % Symbols.size()];
+
+    return word;
+}
+
+//
+// Nanoseconds per call, best of several rounds
+//
+
+double Measure(std::function<void()> const& Call, size_t Calls = 16)
+{
+    double best = 1e300;
+    for (size_t round = 0; round != 5; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t call = 0; call != Calls; call++)
+            Call();
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / double(Calls));
+    }
+
+    return best;
+}
+
+volatile size_t Sink = 0;
+
+//
+// Every allocation of the process is counted, so memory columns
+// include containers the Budget does not charge
+//
+
+std::atomic<size_t> HeapBytes{0};
+std::atomic<size_t> HeapPeak{0};
+
+void* operator new(size_t Size)
+{
+    auto pointer = malloc(Size != 0 ? Size : 1);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    auto current = HeapBytes.fetch_add(malloc_usable_size(pointer), std::memory_order_relaxed) +
+                   malloc_usable_size(pointer);
+
+    auto peak = HeapPeak.load(std::memory_order_relaxed);
+    while (current > peak && !HeapPeak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+        ;
+
+    return pointer;
+}
+
+void operator delete(void* Pointer) noexcept
+{
+    if (Pointer == nullptr)
+        return;
+
+    HeapBytes.fetch_sub(malloc_usable_size(Pointer), std::memory_order_relaxed);
+    free(Pointer);
+}
+
+void operator delete(void* Pointer, size_t) noexcept
+{
+    operator delete(Pointer);
+}
+
+// ******************************************************
+//                     Dead states
+// ******************************************************
+
+//
+// Explicit sink state, as in a completed DFSM table
+//
+
+CompiledAutomaton Complete(CompiledAutomaton const& Automaton)
+{
+    auto const& symbols = Automaton.Symbols();
+    auto sink = CompiledAutomaton::StateId(Automaton.StatesCount());
+
+    std::vector<CompiledAutomaton::StateId> table;
+    std::vector<uint8_t> finite;
+
+    for (CompiledAutomaton::StateId state = 0; state <= sink; state++)
+    {
+        finite.push_back(state != sink && Automaton.Finite(state));
+        for (auto sym : symbols)
+        {
+            auto to = (state == sink) ? CompiledAutomaton::Dead : Automaton.Step(state, sym);
+            table.push_back(to == CompiledAutomaton::Dead ? sink : to);
+        }
+    }
+
+    return CompiledAutomaton::FromTable(symbols, std::move(table), std::move(finite));
+}
+
+void BenchDeadStates()
+{
+    printf("\n%-28s %10s %14s %12s\n", "dead_states", "states", "stepped", "ns/word");
+
+    for (auto const& regexp : { FirstRegexp, SecondRegexp })
+    {
+        auto word = RandomWord("abc", 2000);
+        auto completed = Complete(CompileRegexp(regexp, Abc));
+        auto trimmed = TrimDeadStates(completed);
+
+        for (auto const* automaton : { &completed, &trimmed })
+        {
+            MatchStats stats;
+            Sink = SolveTask13(*automaton, word, &stats);
+
+            auto ns = Measure([&]() { Sink = SolveTask13(*automaton, word); });
+            printf("%-28s %10zu %14zu %12.0f\n",
+                (automaton == &completed ? "  completed" : "  trimmed"),
+                automaton->StatesCount(), stats.SymbolsStepped, ns);
+        }
+    }
+}
+
+// ******************************************************
+//                       Prefilter
+// ******************************************************
+
+//
+// Suffix loop without prefilter, as SolveTask13 was
+//
+
+size_t SolveEveryPosition(CompiledAutomaton const& Automaton, std::string_view Word)
+{
+    size_t maxAcceptedSubstrLen = 0;
+    auto end = Word.data() + Word.length();
+
+    for (auto current = Word.data(); current != end; current++)
+    {
+        if (maxAcceptedSubstrLen >= size_t(end - current))
+            break;
+
+        maxAcceptedSubstrLen = std::max(maxAcceptedSubstrLen,
+            TryAcceptTask13(Automaton, current, end));
+    }
+
+    return maxAcceptedSubstrLen;
+}
+
+//
+// Rare matches in a long word
+//
+
+std::string SparseWord(std::string const& Filler, std::string const& Needle, size_t Length, size_t Every)
+{
+    auto word = RandomWord(Filler, Length);
+    for (size_t position = Every; position + Needle.length() < Length; position += Every)
+        word.replace(position, Needle.length(), Needle);
+
+    return word;
+}
+
+void BenchPrefilter()
+{
+    printf("\n%-28s %12s %12s %12s\n", "prefilter", "first", "MB/s old", "MB/s new");
+
+    AlphabetType alphabet = { 'a', 'b', 'c', 'd' };
+    struct
+    {
+        char const* Regexp;
+        std::string Word;
+    } cases[] =
+    {
+        { "ab.b*.",  SparseWord("cd", "abbb", 1 << 20, 4096) },
+        { "ab+c.",   SparseWord("cd", "ac", 1 << 20, 4096) },
+        { "ab+c+d.", SparseWord("d", "ad", 1 << 20, 4096) },
+    };
+
+    for (auto const& test : cases)
+    {
+        auto automaton = CompileRegexp(test.Regexp, alphabet);
+        double megabytes = double(test.Word.length()) / (1 << 20);
+
+        auto oldNs = Measure([&]() { Sink = SolveEveryPosition(automaton, test.Word); }, 4);
+        auto newNs = Measure([&]() { Sink = SolveTask13(automaton, test.Word); }, 4);
+
+        printf("  %-26s %12s %12.0f %12.0f\n", test.Regexp, automaton.FirstSymbols().Bytes().c_str(),
+            megabytes / (oldNs * 1e-9), megabytes / (newNs * 1e-9));
+    }
+}
+
+// ******************************************************
+//                     Length bounds
+// ******************************************************
+
+void BenchLengthBounds()
+{
+    printf("\n%-28s %8s %8s %12s %12s\n", "length_bounds", "min", "max", "ns old", "ns new");
+
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+    auto word = RandomWord("abc", 1 << 16);
+    struct
+    {
+        char const* Regexp;
+        std::string Word;
+    } cases[] =
+    {
+        { "ab.c.ab+.",     word },
+        { "ab+ab+.ab+.",   word },
+        { "abc..abc...",   word.substr(0, 5) + "abc" },
+        { "ab+*c.",        word },
+    };
+
+    for (auto const& test : cases)
+    {
+        auto automaton = CompileRegexp(test.Regexp, alphabet);
+
+        auto oldNs = Measure([&]() { Sink = SolveEveryPosition(automaton, test.Word); }, 4);
+        auto newNs = Measure([&]() { Sink = SolveTask13(automaton, test.Word); }, 4);
+
+        auto maxLength = automaton.MaxLength();
+        printf("  %-26s %8zu %8s %12.0f %12.0f\n", test.Regexp, automaton.MinLength(),
+            maxLength == CompiledAutomaton::Unbounded ? "inf" : std::to_string(maxLength).c_str(),
+            oldNs, newNs);
+    }
+}
+
+// ******************************************************
+//                        Planner
+// ******************************************************
+
+//
+// (a + b)* a (a + b)^Tail: DFSM has 2^(Tail + 1) states
+//
+
+std::string BlowupRegexp(size_t Tail)
+{
+    std::string regexp = "ab+*a.";
+    for (size_t idx = 0; idx != Tail; idx++)
+        regexp += "ab+.";
+
+    return regexp;
+}
+
+void BenchPlanner()
+{
+    printf("\n%-22s %11s", "planner, us", "word");
+    for (size_t engine = 0; engine != EnginesCount; engine++)
+        printf(" %12s", EngineName(Engine(engine)));
+
+    printf(" %12s  %s\n", "planned", "chosen");
+
+    struct
+    {
+        std::string Regexp;
+        std::string Word;
+    } cases[] =
+    {
+        { FirstRegexp,      RandomWord("abc", 1 << 16) },
+        { FirstRegexp,      RandomWord("abc", 16) },
+        { SecondRegexp,     "abbaa" },
+        { BlowupRegexp(12), RandomWord("ab", 4096) },
+        { BlowupRegexp(12), RandomWord("ab", 64) },
+        { BlowupRegexp(5),  RandomWord("ab", 1 << 16) },
+        { "ab.c.ab+.",      RandomWord("abc", 1 << 16) },
+        { "ab.c.ba.c.+",    RandomWord("abc", 2048) },
+        { "ab+*c.",         RandomWord("ab", 1 << 12) },
+    };
+
+    std::array<double, EnginesCount + 1> totals = {};
+
+    for (auto const& test : cases)
+    {
+        auto regexp = test.Regexp.length() > 20 ? test.Regexp.substr(0, 17) + "..." : test.Regexp;
+        printf("  %-20s %11zu", regexp.c_str(), test.Word.length());
+
+        size_t expected = SolveWithEngine(Engine::Dfsm, test.Regexp, test.Word, Abc);
+
+        size_t calls = (test.Word.length() < 4096) ? 16 : 1;
+
+        for (size_t engine = 0; engine <= EnginesCount; engine++)
+        {
+            double ns = 0;
+            if (engine == EnginesCount)
+                ns = Measure([&]() { Sink = SolvePlanned(test.Regexp, test.Word, Abc); }, calls);
+
+            else if (Engine(engine) == Engine::BitParallel && AnalyzeShape(test.Regexp).Symbols >= BitParallelNfa::MaxStates)
+                ns = NAN;
+
+            else
+            {
+                if (SolveWithEngine(Engine(engine), test.Regexp, test.Word, Abc) != expected)
+                    printf("(mismatch)");
+
+                ns = Measure([&]() { Sink = SolveWithEngine(Engine(engine), test.Regexp, test.Word, Abc); }, calls);
+            }
+
+            totals[engine] += ns;
+            printf(" %12.1f", ns / 1000);
+        }
+
+        auto plan = PlanQuery(test.Regexp, Abc.size(), test.Word.length());
+        printf("  %s\n", EngineName(plan.Chosen));
+    }
+
+    printf("  %-32s", "total");
+    for (auto total : totals)
+        printf(" %12.1f", total / 1000);
+
+    printf("\n");
+}
+
+// ******************************************************
+//                     Pattern set
+// ******************************************************
+
+//
+// Literal of 2..5 symbols, some followed by a starred symbol
+//
+
+std::string RandomPattern(std::mt19937& Rng)
+{
+    std::string regexp(1, "abc"[Rng() % 3]);
+    for (size_t length = 1 + Rng() % 4; length != 0; length--)
+    {
+        regexp += "abc"[Rng() % 3];
+        regexp += '.';
+    }
+
+    if (Rng() % 3 == 0)
+    {
+        regexp += "abc"[Rng() % 3];
+        regexp += "*.";
+    }
+
+    return regexp;
+}
+
+void BenchPatternSet()
+{
+    printf("\n%-22s %8s %8s %12s %12s\n", "pattern_set, us", "groups", "states", "separate", "set");
+
+    std::mt19937 rng(19);
+    auto word = RandomWord("abc", 1 << 16);
+
+    for (size_t count : { 4, 16, 64 })
+    {
+        for (size_t maxStates : { size_t(1 << 8), PatternSet::DefaultMaxStates })
+        {
+            std::vector<std::string> regexps(count);
+            for (auto& regexp : regexps)
+                regexp = RandomPattern(rng);
+
+            std::vector<CompiledAutomaton> automata;
+            for (auto const& regexp : regexps)
+                automata.push_back(CompileRegexp(regexp, Abc));
+
+            auto set = PatternSet::Compile(regexps, Abc, maxStates);
+
+            auto separateNs = Measure([&]()
+            {
+                for (auto const& automaton : automata)
+                    Sink = SolveTask13(automaton, word);
+            }, 2);
+
+            auto setNs = Measure([&]() { Sink = set.Solve(word).size(); }, 2);
+
+            std::vector<size_t> expected;
+            for (auto const& automaton : automata)
+                expected.push_back(SolveTask13(automaton, word));
+
+            auto name = std::to_string(count) + " patterns";
+            printf("  %-20s %8zu %8zu %12.1f %12.1f%s\n", name.c_str(), set.GroupsCount(), set.StatesCount(),
+                separateNs / 1000, setNs / 1000, set.Solve(word) == expected ? "" : " (mismatch)");
+        }
+    }
+}
+
+// ******************************************************
+//                      Word index
+// ******************************************************
+
+void BenchWordIndex()
+{
+    printf("\n%-28s %12s %12s\n", "word_index, us", "scan", "index");
+
+    auto word = RandomWord("abc", 1 << 16);
+
+    auto buildNs = Measure([&]() { Sink = WordIndex(word).StatesCount(); }, 2);
+    WordIndex index(word);
+    printf("  %-26s %12s %12.1f\n", "build", "", buildNs / 1000);
+
+    std::mt19937 rng(23);
+    std::vector<std::string> regexps = { FirstRegexp, SecondRegexp, "ab+*c.", "ab.c.ab+." };
+    for (size_t pattern = 0; pattern != 4; pattern++)
+        regexps.push_back(RandomPattern(rng));
+
+    for (auto const& regexp : regexps)
+    {
+        auto automaton = CompileRegexp(regexp, Abc);
+
+        auto scanNs = Measure([&]() { Sink = SolveTask13(automaton, word); }, 2);
+        auto indexNs = Measure([&]() { Sink = index.Solve(automaton); }, 2);
+
+        auto name = regexp.length() > 26 ? regexp.substr(0, 23) + "..." : regexp;
+        printf("  %-26s %12.1f %12.1f%s\n", name.c_str(), scanNs / 1000, indexNs / 1000,
+            index.Solve(automaton) == SolveTask13(automaton, word) ? "" : " (mismatch)");
+    }
+}
+
+// ******************************************************
+//                     Determinize
+// ******************************************************
+
+void BenchDeterminize()
+{
+    printf("\n%-22s %8s %12s", "determinize, ms", "states", "sequential");
+    for (size_t threads : { 1, 2, 4, 8 })
+        printf(" %9zu thr", threads);
+
+    printf("\n");
+
+    AlphabetType alphabet = { 'a', 'b' };
+
+    for (size_t tail : { 10, 13, 15 })
+    {
+        auto regexp = BlowupRegexp(tail);
+        auto nfa = CompileNfa(regexp, alphabet);
+
+        auto states = DeterminizeParallel(nfa, 1).StatesCount();
+        auto name = "blowup " + std::to_string(tail);
+        printf("  %-20s %8zu", name.c_str(), states);
+
+        auto sequentialNs = Measure([&]() { Sink = CompileRegexp(regexp, alphabet).StatesCount(); }, 1);
+        printf(" %12.1f", sequentialNs / 1e6);
+
+        for (size_t threads : { 1, 2, 4, 8 })
+        {
+            auto ns = Measure([&]() { Sink = DeterminizeParallel(nfa, threads).StatesCount(); }, 1);
+            printf(" %13.1f", ns / 1e6);
+        }
+
+        printf("\n");
+    }
+}
+
+// ******************************************************
+//                 Thompson determinization
+// ******************************************************
+
+//
+// Bytes are the peak of the heap during the compilation: States,
+// closures, subset maps and queues together
+//
+
+void BenchThompsonDfsm()
+{
+    printf("\n%-28s %10s %10s %12s %12s\n", "thompson_dfsm", "us old", "us new", "KiB old", "KiB new");
+
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    std::string literals = "abc..";
+    for (size_t idx = 0; idx != 30; idx++)
+        literals += std::string(1, "abc"[idx % 3]) + "bca"[idx % 3] + "." + "cab"[(idx / 3) % 3] + ".+";
+
+    std::string nested = "a";
+    for (size_t depth = 0; depth != 8; depth++)
+        nested += std::string(1, "abc"[depth % 3]) + "+*";
+
+    struct
+    {
+        char const* Name;
+        std::string Regexp;
+    } cases[] =
+    {
+        { "first",          FirstRegexp },
+        { "second",         SecondRegexp },
+        { "blowup 8",       BlowupRegexp(8) },
+        { "31 literals",    literals },
+        { "nested stars 8", nested },
+    };
+
+    for (auto const& test : cases)
+    {
+        auto bytes = [&](auto Compile)
+        {
+            auto base = HeapBytes.load();
+            HeapPeak = base;
+            Compile(test.Regexp, alphabet);
+            return HeapPeak - base;
+        };
+
+        auto oldNs = Measure([&]() { Sink = CompileViaEpsRemoval(test.Regexp, alphabet).StatesCount(); }, 4);
+        auto newNs = Measure([&]() { Sink = CompileRegexp(test.Regexp, alphabet).StatesCount(); }, 4);
+
+        printf("  %-26s %10.1f %10.1f %12.1f %12.1f\n", test.Name, oldNs / 1000, newNs / 1000,
+            bytes([](auto const& Regexp, auto const& Alphabet) { return CompileViaEpsRemoval(Regexp, Alphabet); }) / 1024.0,
+            bytes([](auto const& Regexp, auto const& Alphabet) { return CompileRegexp(Regexp, Alphabet); }) / 1024.0);
+    }
+}
+
+// ******************************************************
+//                     States layout
+// ******************************************************
+
+//
+// Star of a dictionary union over a-z (a tokenizer) and a text
+// of its words with Zipf frequencies: a run lasts the whole text
+//
+
+struct Dictionary
+{
+    std::vector<std::string> Words;
+    std::string Regexp;
+    std::string Letters;
+};
+
+Dictionary MakeDictionary(size_t WordsCount, unsigned Seed)
+{
+    Dictionary dictionary;
+    for (char letter = 'a'; letter <= 'z'; letter++)
+        dictionary.Letters += letter;
+
+    std::mt19937 rng(Seed);
+    for (size_t idx = 0; idx != WordsCount; idx++)
+    {
+        std::string word(4 + rng() % 7, '\0');
+        for (auto& letter : word)
+            letter = dictionary.Letters[rng() % 26];
+
+        std::string regexp(1, word[0]);
+        for (size_t position = 1; position != word.length(); position++)
+            regexp += std::string(1, word[position]) + ".";
+
+        dictionary.Regexp += regexp;
+        if (idx != 0)
+            dictionary.Regexp += "+";
+
+        dictionary.Words.push_back(std::move(word));
+    }
+
+    dictionary.Regexp += "*";
+    return dictionary;
+}
+
+std::string ZipfText(Dictionary const& Words, size_t Length, unsigned Seed)
+{
+    std::vector<double> weights;
+    for (size_t rank = 1; rank <= Words.Words.size(); rank++)
+        weights.push_back(1.0 / double(rank));
+
+    std::mt19937 rng(Seed);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+    std::string text;
+    while (text.length() < Length)
+        text += Words.Words[pick(rng)];
+
+    return text;
+}
+
+void BenchLayout()
+{
+    printf("\n%-22s %8s %12s %12s %12s %12s\n", "layout, us", "states", "compiled", "shuffled", "bfs", "profile");
+
+    for (size_t wordsCount : { 500, 4000 })
+    {
+        auto dictionary = MakeDictionary(wordsCount, 29);
+        AlphabetType alphabet(dictionary.Letters.begin(), dictionary.Letters.end());
+        auto compiled = CompileRegexp(dictionary.Regexp, alphabet);
+
+        std::vector<CompiledAutomaton::StateId> order(compiled.StatesCount());
+        for (size_t state = 0; state != order.size(); state++)
+            order[state] = CompiledAutomaton::StateId(state);
+
+        std::shuffle(order.begin() + 1, order.end(), std::mt19937(31));
+        auto shuffled = Renumber(compiled, order);
+
+        //
+        // Profile comes from another text of the same distribution
+        //
+
+        auto profileText = ZipfText(dictionary, 1 << 16, 37);
+        auto text = ZipfText(dictionary, 1 << 20, 41);
+
+        CompiledAutomaton layouts[] =
+        {
+            compiled,
+            shuffled,
+            RenumberBreadthFirst(compiled),
+            RenumberByVisits(compiled, CountVisits(compiled, { profileText })),
+        };
+
+        auto name = std::to_string(wordsCount) + " words";
+        printf("  %-20s %8zu", name.c_str(), compiled.StatesCount());
+
+        auto expected = SolveTask13(compiled, text);
+        for (auto const& layout : layouts)
+        {
+            auto ns = Measure([&]() { Sink = SolveTask13(layout, text); }, 4);
+            printf(" %12.1f", ns / 1000);
+
+            if (SolveTask13(layout, text) != expected)
+                printf("(mismatch)");
+        }
+
+        printf("\n");
+    }
+}
+
+//
+// Same text over the dense and the comb vector tables of both
+// id widths; "-" is for a DFSM not fitting into 16 bits
+//
+
+template <typename Table>
+void MeasureTable(CompiledAutomaton const& Automaton, std::string const& Text)
+{
+    try
+    {
+        auto table = Table::FromCompiled(Automaton);
+        auto ns = Measure([&]() { Sink = SolveTable(table, Text); }, 4);
+        printf(" %8.1f/%-6zu", ns / 1000, table.TableBytes() >> 10);
+
+        if (SolveTable(table, Text) != SolveTask13(Automaton, Text))
+            printf("(mismatch)");
+    }
+
+    catch (std::runtime_error const&)
+    {
+        printf(" %15s", "-");
+    }
+}
+
+void BenchTables()
+{
+    printf("\n%-22s %8s %15s %15s %15s %15s\n", "tables, us/KiB", "states",
+           "dense32", "dense16", "comb32", "comb16");
+
+    struct Case
+    {
+        std::string Name;
+        CompiledAutomaton Automaton;
+        std::string Text;
+    };
+
+    std::vector<Case> cases;
+    for (size_t wordsCount : { 100, 1000, 4000, 8000 })
+    {
+        auto dictionary = MakeDictionary(wordsCount, 29);
+        AlphabetType alphabet(dictionary.Letters.begin(), dictionary.Letters.end());
+        cases.push_back({ std::to_string(wordsCount) + " words",
+                          CompileRegexp(dictionary.Regexp, alphabet),
+                          ZipfText(dictionary, 1 << 20, 41) });
+    }
+
+    for (size_t tail : { 8, 15 })
+        cases.push_back({ "blowup " + std::to_string(tail),
+                          CompileRegexp(BlowupRegexp(tail), { 'a', 'b' }),
+                          RandomWord("ab", 1 << 16) });
+
+    for (auto const& test : cases)
+    {
+        printf("  %-20s %8zu", test.Name.c_str(), test.Automaton.StatesCount());
+        MeasureTable<DenseTable<uint32_t>>(test.Automaton, test.Text);
+        MeasureTable<DenseTable<uint16_t>>(test.Automaton, test.Text);
+        MeasureTable<CombTable<uint32_t>>(test.Automaton, test.Text);
+        MeasureTable<CombTable<uint16_t>>(test.Automaton, test.Text);
+        printf("\n");
+    }
+}
+
+//
+// Words of runs of random lengths 1..2 * Average; bytes is the dense
+// table stepping every symbol from every start
+//
+
+std::string RandomRuns(std::string const& Symbols, size_t Length, size_t Average, unsigned Seed)
+{
+    std::mt19937 rng(Seed);
+    std::string word;
+    while (word.length() < Length)
+        word += std::string(1 + rng() % (2 * Average), Symbols[rng() % Symbols.size()]);
+
+    word.resize(Length);
+    return word;
+}
+
+void BenchRuns()
+{
+    printf("\n%-22s %8s %12s %12s %12s\n", "runs, us", "average", "bytes", "runs", "encode+runs");
+
+    for (auto regexp : { "ab+*c.", "aa.*b." })
+    {
+        auto compiled = CompileRegexp(regexp, Abc);
+        auto dense = DenseTable<uint32_t>::FromCompiled(compiled);
+
+        for (size_t average : { 4, 64, 1024 })
+        {
+            auto text = RandomRuns("abc", 1 << 16, average, 43);
+            auto runs = EncodeRuns(text);
+
+            printf("  %-20s %8zu", regexp, average);
+            printf(" %12.1f", Measure([&]() { Sink = SolveTable(dense, text); }, 2) / 1000);
+            printf(" %12.1f", Measure([&]() { Sink = SolveTask13(compiled, runs); }, 2) / 1000);
+            printf(" %12.1f", Measure([&]() { Sink = SolveTask13(compiled, EncodeRuns(text)); }, 2) / 1000);
+
+            if (SolveTask13(compiled, runs) != SolveTable(dense, text))
+                printf("(mismatch)");
+
+            printf("\n");
+        }
+    }
+}
+
+//
+// Whole NDFSM determinized vs operands minimized at every operator;
+// states are of the DFSM compiled and the largest intermediate one
+//
+
+void BenchBottomUp()
+{
+    printf("\n%-22s %10s %10s %10s %10s %10s\n", "bottom_up, us", "whole", "states",
+           "bottom_up", "peak", "minimal");
+
+    struct Case
+    {
+        std::string Name;
+        std::string Regexp;
+        AlphabetType Alphabet;
+    };
+
+    std::vector<Case> cases;
+    for (size_t wordsCount : { 50, 200, 800 })
+    {
+        auto dictionary = MakeDictionary(wordsCount, 47);
+        cases.push_back({ std::to_string(wordsCount) + " words", dictionary.Regexp,
+                          AlphabetType(dictionary.Letters.begin(), dictionary.Letters.end()) });
+    }
+
+    for (size_t tail : { 6, 14 })
+        cases.push_back({ "blowup " + std::to_string(tail), BlowupRegexp(tail), { 'a', 'b' } });
+
+    for (auto const& test : cases)
+    {
+        BottomUpStats stats;
+        auto whole = CompileRegexp(test.Regexp, test.Alphabet);
+        auto bottomUp = CompileRegexpBottomUp(test.Regexp, test.Alphabet, BottomUpMaxStates, &stats);
+
+        auto wholeNs = Measure([&]() { Sink = CompileRegexp(test.Regexp, test.Alphabet).StatesCount(); }, 2);
+        auto bottomUpNs = Measure([&]() { Sink = CompileRegexpBottomUp(test.Regexp, test.Alphabet).StatesCount(); }, 2);
+
+        printf("  %-20s %10.1f %10zu %10.1f %10zu %10zu%s\n", test.Name.c_str(),
+               wholeNs / 1000, whole.StatesCount(), bottomUpNs / 1000, stats.PeakStates,
+               bottomUp.StatesCount(), stats.FellBack ? " (fell back)" : "");
+    }
+}
+
+//
+// Eps-removed NDFSM with bisimilar states merged, then determinized
+//
+
+void BenchBisimulation()
+{
+    printf("\n%-22s %10s %10s %10s %10s %10s %10s\n", "bisimulation, us", "nfa", "reduced",
+           "dfsm", "reduced", "plain", "reduced");
+
+    struct Case
+    {
+        std::string Name;
+        std::string Regexp;
+        AlphabetType Alphabet;
+    };
+
+    std::vector<Case> cases;
+    for (size_t wordsCount : { 25, 50, 100 })
+    {
+        auto dictionary = MakeDictionary(wordsCount, 53);
+        cases.push_back({ std::to_string(wordsCount) + " words", dictionary.Regexp,
+                          AlphabetType(dictionary.Letters.begin(), dictionary.Letters.end()) });
+    }
+
+    cases.push_back({ "blowup 10", BlowupRegexp(10), { 'a', 'b' } });
+    cases.push_back({ "nested stars", "ab+*c.*ab.*+*ca+*.", Abc });
+
+    for (auto const& test : cases)
+    {
+        ReductionStats stats;
+        auto plain = CompileViaEpsRemoval(test.Regexp, test.Alphabet);
+        auto reduced = CompileViaEpsRemoval(test.Regexp, test.Alphabet, &stats);
+
+        auto plainNs = Measure([&]() { Sink = CompileViaEpsRemoval(test.Regexp, test.Alphabet).StatesCount(); }, 2);
+        auto reducedNs = Measure([&]() { Sink = CompileViaEpsRemoval(test.Regexp, test.Alphabet, &stats).StatesCount(); }, 2);
+
+        printf("  %-20s %10zu %10zu %10zu %10zu %10.1f %10.1f\n", test.Name.c_str(),
+               stats.StatesBefore, stats.StatesAfter, plain.StatesCount(), reduced.StatesCount(),
+               plainNs / 1000, reducedNs / 1000);
+    }
+}
+
+//
+// Dictionary tokenizers (star of a union of literal words)
+//
+
+void BenchLiterals()
+{
+    printf("\n%-22s %12s %12s %12s %12s\n", "literals, us", "dfsm", "states", "nfa", "states");
+
+    for (size_t wordsCount : { 100, 1000, 4000, 16000 })
+    {
+        auto dictionary = MakeDictionary(wordsCount, 59);
+        AlphabetType alphabet(dictionary.Letters.begin(), dictionary.Letters.end());
+
+        auto name = std::to_string(wordsCount) + " words";
+        printf("  %-20s", name.c_str());
+
+        size_t states = 0;
+        auto ns = Measure([&]() { states = CompileRegexp(dictionary.Regexp, alphabet).StatesCount(); }, 2);
+        printf(" %12.1f %12zu", ns / 1000, states);
+
+        ns = Measure([&]() { states = CompileNfa(dictionary.Regexp, alphabet).StatesCount(); }, 2);
+        printf(" %12.1f %12zu\n", ns / 1000, states);
+    }
+}
+
+//
+// CompileRegexp with the regexp parsed as written
+//
+
+CompiledAutomaton CompileUnsimplified(std::string const& Regexp, AlphabetType const& Alphabet, size_t* ThompsonStates)
+{
+    Automaton::StartUsing();
+
+    auto automaton = ParseReversePolishRegexp(Regexp, Alphabet);
+    *ThompsonStates = CollectReachable(automaton.Initial).size();
+    automaton = ThompsonToDfsm(automaton, Alphabet);
+    automaton = CompactStates(automaton);
+    automaton = RemoveUselessStates(automaton);
+
+    auto compiled = CompiledAutomaton::FromDfsm(automaton, Alphabet);
+    Automaton::EndUsing();
+    return compiled;
+}
+
+void BenchAst()
+{
+    printf("\n%-22s %10s %10s %10s %10s %10s %10s\n", "ast, us", "tree", "dag",
+           "thompson", "lowered", "as_written", "simplified");
+
+    struct Case
+    {
+        std::string Name;
+        std::string Regexp;
+        AlphabetType Alphabet;
+    };
+
+    std::vector<Case> cases;
+
+    std::string nested = "ab.c+";
+    for (size_t depth = 0; depth != 64; depth++)
+        nested += (depth % 2 == 0) ? "*" : "1+";
+
+    cases.push_back({ "nested stars", nested + "a.", Abc });
+
+    std::string repeated = "ab+*c.";
+    for (size_t copy = 0; copy != 63; copy++)
+        repeated += "ab+*c.+";
+
+    cases.push_back({ "repeated union", repeated + "*", Abc });
+
+    auto dictionary = MakeDictionary(1000, 61);
+    cases.push_back({ "dictionary twice", dictionary.Regexp + dictionary.Regexp + "+",
+                      AlphabetType(dictionary.Letters.begin(), dictionary.Letters.end()) });
+
+    cases.push_back({ "blowup 10", BlowupRegexp(10), { 'a', 'b' } });
+
+    for (auto const& test : cases)
+    {
+        RegexpAst ast;
+        auto root = ast.Parse(test.Regexp, test.Alphabet);
+
+        size_t thompson = 0;
+        auto expected = CompileUnsimplified(test.Regexp, test.Alphabet, &thompson);
+
+        Automaton::StartUsing();
+        auto lowered = CollectReachable(ast.Lower(root).Initial).size();
+        Automaton::EndUsing();
+
+        auto writtenNs = Measure([&]() { Sink = CompileUnsimplified(test.Regexp, test.Alphabet, &thompson).StatesCount(); }, 2);
+        auto simplifiedNs = Measure([&]() { Sink = CompileRegexp(test.Regexp, test.Alphabet).StatesCount(); }, 2);
+
+        printf("  %-20s %10llu %10zu %10zu %10zu %10.1f %10.1f", test.Name.c_str(),
+               (unsigned long long)ast.TreeSize(root), ast.Size(), thompson, lowered,
+               writtenNs / 1000, simplifiedNs / 1000);
+
+        if (Minimize(CompileRegexp(test.Regexp, test.Alphabet)).StatesCount() != Minimize(expected).StatesCount())
+            printf("(mismatch)");
+
+        printf("\n");
+    }
+}
+
+// ******************************************************
+//                        Main
+// ******************************************************
+
+struct Benchmark
+{
+    char const* Name;
+    void (*Run)();
+};
+
+int main(int argc, char** argv)
+{
+    std::string filter = (argc > 1) ? argv[1] : "";
+
+    std::vector<Benchmark> benchmarks =
+    {
+        { "dead_states", BenchDeadStates },
+        { "prefilter",   BenchPrefilter },
+        { "length_bounds", BenchLengthBounds },
+        { "planner",     BenchPlanner },
+        { "pattern_set", BenchPatternSet },
+        { "word_index",  BenchWordIndex },
+        { "determinize", BenchDeterminize },
+        { "thompson_dfsm", BenchThompsonDfsm },
+        { "layout",      BenchLayout },
+        { "tables",      BenchTables },
+        { "runs",        BenchRuns },
+        { "bottom_up",   BenchBottomUp },
+        { "bisimulation", BenchBisimulation },
+        { "literals",    BenchLiterals },
+        { "ast",         BenchAst },
+    };
+
+    for (auto const& benchmark : benchmarks)
+        if (std::string(benchmark.Name).find(filter) != std::string::npos)
+            benchmark.Run();
+}
@@ -0,0 +1,150 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Ast.h
+
+Abstract:
+
+    Hash-consed regexp syntax tree.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Automaton.h>
+#include <Common.h>
+
+//
+// Definitions
+//
+
+//
+// Nodes are interned by their kind, symbol and children, so
+// structurally equal subexpressions are one node
+//
+
+class RegexpAst
+{
+public:
+    using NodeId = uint32_t;
+
+    enum class Kind : uint8_t
+    {
+        One,
+        Symbol,
+        Concat,
+        Union,
+        Kleene,
+    };
+
+    struct Node
+    {
+        Kind Type = Kind::One;
+        char Sym = 0;
+        bool Nullable = false;
+        std::vector<NodeId> Children;
+    };
+
+protected:
+    struct KeyHash
+    {
+        size_t operator()(std::vector<uint32_t> const& Key) const;
+    };
+
+    std::vector<Node> Nodes_;
+    std::unordered_map<std::vector<uint32_t>, NodeId, KeyHash> Interned_;
+
+    NodeId Intern(Kind Type, char Sym, std::vector<NodeId> Children);
+    bool LiteralWord(NodeId Id, std::string& Word) const;
+
+    //
+    // Source itself, or its children if it is a union
+    //
+
+    void AddAlternatives(NodeId Source, std::vector<NodeId>& Alternatives) const;
+
+public:
+    //
+    // Nodes are simplified as they are made:
+    //
+    //     (r*)*    -> r*          1*      -> 1
+    //     (1 + r)* -> r*          r + r   -> r
+    //     1.r, r.1 -> r           r*.r*   -> r*
+    //
+    // Unions and concatenations are flattened. Unions are also sorted by
+    // node, so the order of alternatives does not matter, and 1 is
+    // dropped from a union with another nullable alternative
+    //
+
+    NodeId One();
+    NodeId Symbol(char Sym);
+    NodeId Concat(NodeId First, NodeId Second);
+    NodeId Union(NodeId First, NodeId Second);
+    NodeId Kleene(NodeId Source);
+
+    //
+    // Union of all Alternatives at once (unions among them are not
+    // flattened, see AddAlternatives)
+    //
+
+    NodeId Union(std::vector<NodeId> Alternatives);
+
+    //
+    // Throws std::runtime_error on a malformed regexp, with the messages
+    // of ParseReversePolishRegexp
+    //
+
+    NodeId Parse(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+
+    Node const& Get(NodeId Id) const
+    {
+        return Nodes_[Id];
+    }
+
+    //
+    // Distinct nodes
+    //
+
+    size_t Size() const
+    {
+        return Nodes_.size();
+    }
+
+    //
+    // Nodes of Root as a tree, shared subexpressions counted every time
+    //
+
+    uint64_t TreeSize(NodeId Root) const;
+
+    std::string ToReversePolish(NodeId Root) const;
+
+    //
+    // Fresh Thompson NDFSM (a single finite state) for every call. A union
+    // of at least LiteralUnionMinWords literal words becomes a trie
+    //
+
+    Automaton Lower(NodeId Root) const;
+};
+
+//
+// Parse + Lower: drop-in replacement of ParseReversePolishRegexp
+//
+
+Automaton ParseSimplified(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
@@ -27,6 +27,7 @@ Revision History:
 #include <cassert>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <Common.h>
 
@@ -58,33 +59,71 @@ public:
     using StatesContainer = std::set<State*>;
 
 protected:
-    static size_t TotalAllocated_;
-    static StatesContainer Allocated_;
+    static thread_local size_t TotalAllocated_;
+    static thread_local StatesContainer Allocated_;
+
+    //
+    // Ids of the NDFSM states a DFSM state was built from,
+    // recorded only while provenance is tracked
+    //
+
+    static thread_local bool TrackProvenance_;
+    static thread_local std::unordered_map<State const*, std::vector<size_t>> Subsets_;
 
     size_t const Id_ = 0;
     Color Color_ = Color::White;
-    std::string Name_;
+    char Origin_ = 0;
     bool Finite_ = false;
 
     TransitionsContainer Outputs_;
     TransitionsContainer Inputs_;
     
-    State(size_t Id, std::string Name);
+    State(size_t Id, char Origin);
     ~State() = default;
 
 public:
-    static State* Allocate(std::string Name = "\0");
+    //
+    // Origin -- regexp symbol or operator the state was created for (0 if none)
+    //
+
+    static State* Allocate(char Origin = 0);
     static void DestructAll();
-    static void ResetAll();
+
+    //
+    // Alive must be closed under transitions
+    //
+
+    static void DestructUnreachable(StatesContainer const& Alive);
     static StatesContainer const& AllocatedStates()
     {
         return Allocated_;
     }
 
+    //
+    // Until EndUsing; needed only to name DFSM states for debugging
+    //
+
+    static void inline TrackProvenance()
+    {
+        TrackProvenance_ = true;
+    }
+
+    template <typename Container>
+    void SetSubset(Container const& Members)
+    {
+        if (!TrackProvenance_)
+            return;
+
+        auto& subset = Subsets_[this];
+        for (auto member : Members)
+            subset.push_back(member->Id());
+    }
+
     void Connect(State* To, char Sym);
     void Disconnect(State* To, char Sym);
 
     TransitionsContainer const& Transitions();
+    TransitionsContainer const& InputTransitions();
     TransitionsContainer TransitionsBy(char Sym);
     State* To(char Sym);
 
@@ -108,16 +147,23 @@ public:
         Color_ = Color::Black;
     }
 
-    void inline SetName(std::string NewName)
+    void inline ResetVisit()
     {
-        Name_ = NewName;
+        Color_ = Color::White;
     }
 
-    std::string const& Name()
+    void inline SetOrigin(char Origin)
     {
-        return Name_;
+        Origin_ = Origin;
     }
 
+    //
+    // Built on demand: "3|7|12" for a DFSM state with a tracked subset,
+    // the origin otherwise
+    //
+
+    std::string Name() const;
+
     void inline SetFinite()
     {
         Finite_ = true;
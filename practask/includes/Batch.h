@@ -0,0 +1,62 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Batch.h
+
+Abstract:
+
+    Batch mode declarations. Every input line is a query
+
+        <regexp> [word]
+
+    Answers (or "Error!<what>") are printed one per line in input order.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <iostream>
+#include <string>
+#include <Common.h>
+#include <Budget.h>
+#include <Cache.h>
+#include <ThreadPool.h>
+
+//
+// Definitions
+//
+
+//
+// Every query runs under its own Budget of QueryLimits
+//
+
+std::string SolveQuery
+(
+    std::string const& Line,
+    AlphabetType const& Alphabet,
+    AutomataCache& Cache,
+    Limits const& QueryLimits = {}
+);
+
+void RunBatch
+(
+    std::istream& Input,
+    std::ostream& Output,
+    AlphabetType const& Alphabet,
+    ThreadPool& Pool,
+    AutomataCache& Cache,
+    Limits const& QueryLimits = {}
+);
@@ -0,0 +1,96 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    BottomUp.h
+
+Abstract:
+
+    Bottom-up compilation of a reverse polish regexp.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <optional>
+#include <string>
+#include <Common.h>
+#include <Compiled.h>
+
+//
+// Definitions
+//
+
+size_t const BottomUpMaxStates = 1 << 12;
+
+//
+// Operands are DFSMs over the same symbols. nullopt if the result
+// (before minimization) exceeds MaxStates.
+//
+// States of the result are:
+//
+//     +  -- product of the operands
+//     .  -- first operand's state with the subset of the second's
+//     *  -- subsets of the operand's states
+//
+
+std::optional<CompiledAutomaton> DfsmUnion
+(
+    CompiledAutomaton const& First,
+    CompiledAutomaton const& Second,
+    size_t MaxStates = CompiledAutomaton::Unbounded
+);
+
+std::optional<CompiledAutomaton> DfsmConcat
+(
+    CompiledAutomaton const& First,
+    CompiledAutomaton const& Second,
+    size_t MaxStates = CompiledAutomaton::Unbounded
+);
+
+std::optional<CompiledAutomaton> DfsmKleene
+(
+    CompiledAutomaton const& Source,
+    size_t MaxStates = CompiledAutomaton::Unbounded
+);
+
+struct BottomUpStats
+{
+    //
+    // Largest DFSM built by an operator, before minimization
+    //
+
+    size_t PeakStates = 0;
+    bool FellBack = false;
+};
+
+//
+// Instead of one Thompson NDFSM determinized as a whole, every operand
+// is a minimized DFSM and every operator minimizes its result again, so
+// subexpressions with small minimal DFSMs never grow big. If an operator
+// exceeds MaxStates, the whole regexp goes to CompileRegexp instead.
+//
+// Result is minimized and trimmed (just trimmed if it fell back).
+// Throws std::runtime_error on a malformed regexp, as
+// ParseReversePolishRegexp does.
+//
+
+CompiledAutomaton CompileRegexpBottomUp
+(
+    std::string const& ReversePolishRegexp,
+    AlphabetType const& Alphabet,
+    size_t MaxStates = BottomUpMaxStates,
+    BottomUpStats* Stats = nullptr
+);
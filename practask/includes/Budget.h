@@ -0,0 +1,158 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Budget.h
+
+Abstract:
+
+    Resource limits of a single query.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+//
+// Definitions
+//
+
+//
+// Zero means no limit
+//
+
+struct Limits
+{
+    size_t MaxDfsmStates = 0;
+    size_t MaxBytes = 0;
+    std::chrono::milliseconds Timeout{0};
+};
+
+class BudgetExceeded : public std::runtime_error
+{
+public:
+    enum class Resource : uint8_t
+    {
+        DfsmStates,
+        Bytes,
+        Deadline,
+    };
+
+protected:
+    Resource Resource_;
+
+public:
+    explicit BudgetExceeded(Resource Exhausted);
+
+    Resource inline Exhausted() const
+    {
+        return Resource_;
+    }
+};
+
+//
+// Installed for the current thread (as the states allocator is) and
+// checked cooperatively: by the states allocator, by the closure and
+// determinization loops and by the matchers. Exceeding it throws
+// BudgetExceeded. Without a Budget every check is a no-op
+//
+
+class Budget
+{
+protected:
+    static thread_local Budget* Current_;
+
+    //
+    // Deadline is checked once per TickPeriod units of work
+    //
+
+    static size_t const TickPeriod = 4096;
+
+    Budget* Previous_;
+    Limits Limits_;
+    std::chrono::steady_clock::time_point Deadline_;
+
+    size_t DfsmStates_ = 0;
+    size_t Bytes_ = 0;
+    size_t Work_ = 0;
+
+    void CheckDeadline();
+
+public:
+    //
+    // Installed until destruction, budgets nest
+    //
+
+    explicit Budget(Limits const& Limits);
+    ~Budget();
+
+    Budget(Budget const&) = delete;
+    Budget& operator=(Budget const&) = delete;
+
+    static Budget* Current()
+    {
+        return Current_;
+    }
+
+    Limits const& GetLimits() const
+    {
+        return Limits_;
+    }
+
+    //
+    // time_point::max() without timeout
+    //
+
+    std::chrono::steady_clock::time_point Deadline() const
+    {
+        if (Limits_.Timeout.count() == 0)
+            return std::chrono::steady_clock::time_point::max();
+
+        return Deadline_;
+    }
+
+    //
+    // Forgets states and bytes of an abandoned attempt (keeps the deadline)
+    //
+
+    void ResetUsage();
+
+    size_t inline UsedDfsmStates() const
+    {
+        return DfsmStates_;
+    }
+
+    size_t inline UsedBytes() const
+    {
+        return Bytes_;
+    }
+
+    static void ChargeDfsmState();
+    static void ChargeBytes(size_t Bytes);
+
+    static void inline Tick(size_t Work = 1)
+    {
+        auto budget = Current_;
+        if (budget == nullptr)
+            return;
+
+        budget->Work_ += Work;
+        if (budget->Work_ >= TickPeriod)
+            budget->CheckDeadline();
+    }
+};
@@ -0,0 +1,117 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Cache.h
+
+Abstract:
+
+    Thread-safe cache of compiled automatons.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <Common.h>
+#include <Compiled.h>
+#include <Nfa.h>
+
+//
+// Definitions
+//
+
+//
+// DFSM tables and NDFSM tables are kept apart, keyed by (regexp,
+// alphabet). Concurrent requests for the same key wait for a single
+// compilation
+//
+
+class AutomataCache
+{
+public:
+    using Pointer = std::shared_ptr<CompiledAutomaton const>;
+    using NfaPointer = std::shared_ptr<CompiledNfa const>;
+
+    static constexpr size_t DefaultCapacity = 1024;
+
+protected:
+    template <typename Compiled>
+    struct EntriesType
+    {
+        using Future = std::shared_future<std::shared_ptr<Compiled const>>;
+
+        //
+        // Keys, most recently used first
+        //
+
+        std::list<std::string> Order;
+        std::unordered_map<std::string, std::pair<Future, std::list<std::string>::iterator>> Map;
+    };
+
+    std::mutex Mutex_;
+    size_t Capacity_;
+    EntriesType<CompiledAutomaton> Entries_;
+    EntriesType<CompiledNfa> NfaEntries_;
+    std::atomic<size_t> Hits_{0};
+    std::atomic<size_t> Misses_{0};
+
+    template <typename Compiled, typename Compiler>
+    std::shared_ptr<Compiled const> Lookup(EntriesType<Compiled>& Entries, std::string const& Key, Compiler const& Compile);
+
+public:
+    //
+    // Holds at most Capacity automatons of each kind, least recently
+    // used ones are evicted. Capacity == 0 means unbounded
+    //
+
+    explicit AutomataCache(size_t Capacity = DefaultCapacity);
+
+    //
+    // Rethrows compilation error (for every caller of the key). Only
+    // malformed regexps are remembered: other failures (out of Budget,
+    // out of memory) may not repeat, so the waiters compile the key
+    // again under their own Budget. Waiting for a compilation started
+    // by another query throws BudgetExceeded past own deadline.
+    //
+
+    Pointer Get(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+    NfaPointer GetNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+
+    //
+    // Do not count as a lookup
+    //
+
+    bool Contains(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+    bool ContainsNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+
+    size_t inline Hits() const
+    {
+        return Hits_;
+    }
+
+    size_t inline Misses() const
+    {
+        return Misses_;
+    }
+
+    size_t Size();
+};
@@ -0,0 +1,252 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Compiled.h
+
+Abstract:
+
+    Table-driven (compiled) DFSM definition. Unlike Automaton, compiled
+    automaton owns its states and does not depend on State allocator,
+    so it outlives Automaton::EndUsing().
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Common.h>
+#include <Automaton.h>
+#include <Scan.h>
+
+//
+// Definitions
+//
+
+class CompiledAutomaton
+{
+public:
+    using StateId = uint32_t;
+    using NarrowId = uint16_t;
+    static constexpr StateId Dead = UINT32_MAX;
+    static constexpr NarrowId NarrowDead = UINT16_MAX;
+    static constexpr size_t Unbounded = SIZE_MAX;
+
+protected:
+    std::string Symbols_;
+    std::array<int16_t, 256> Columns_;
+
+    //
+    // Only one of the tables is kept: 16-bit ids (NarrowDead for Dead)
+    // when the states fit, which halves the table the matching loop
+    // walks through
+    //
+
+    bool Narrow_ = false;
+    std::vector<StateId> Table_;
+    std::vector<NarrowId> NarrowTable_;
+
+    std::vector<uint8_t> Finite_;
+
+    ByteScanner FirstSymbols_;
+    std::string RequiredPrefix_;
+
+    size_t MinLength_ = 0;
+    size_t MaxLength_ = 0;
+
+    void PickWidth();
+    void Analyze();
+    void AnalyzeLengths();
+
+public:
+    CompiledAutomaton();
+
+    //
+    // Dfsm states are numbered in allocation order,
+    // Dfsm.Initial always becomes state 0.
+    //
+
+    static CompiledAutomaton FromDfsm(Automaton Dfsm, AlphabetType const& Alphabet);
+
+    //
+    // Table is [state * Symbols.size() + column], state 0 is initial
+    //
+
+    static CompiledAutomaton FromTable
+    (
+        std::string Symbols,
+        std::vector<StateId> Table,
+        std::vector<uint8_t> Finite
+    );
+
+    StateId inline Initial() const
+    {
+        return 0;
+    }
+
+    size_t inline StatesCount() const
+    {
+        return Finite_.size();
+    }
+
+    size_t inline AlphabetSize() const
+    {
+        return Symbols_.size();
+    }
+
+    std::string const& Symbols() const
+    {
+        return Symbols_;
+    }
+
+    StateId inline Step(StateId From, char Sym) const
+    {
+        auto column = Columns_[uint8_t(Sym)];
+        if (column < 0)
+            return Dead;
+
+        auto index = From * Symbols_.size() + column;
+        if (Narrow_)
+            return NarrowTable_[index] == NarrowDead ? Dead : NarrowTable_[index];
+
+        return Table_[index];
+    }
+
+    //
+    // Raw table for the loops that choose the width once: Table<NarrowId>()
+    // if IsNarrow(), Table<StateId>() otherwise, [state * AlphabetSize() + Column(sym)]
+    //
+
+    bool inline IsNarrow() const
+    {
+        return Narrow_;
+    }
+
+    template <typename Id>
+    Id const* Table() const;
+
+    int16_t inline Column(char Sym) const
+    {
+        return Columns_[uint8_t(Sym)];
+    }
+
+    bool inline Finite(StateId State) const
+    {
+        return Finite_[State];
+    }
+
+    //
+    // Symbols having a transition from the initial state:
+    // every nonempty accepted word starts with one of them
+    //
+
+    ByteScanner const& FirstSymbols() const
+    {
+        return FirstSymbols_;
+    }
+
+    //
+    // Literal every nonempty accepted word starts with (may be empty)
+    //
+
+    std::string const& RequiredPrefix() const
+    {
+        return RequiredPrefix_;
+    }
+
+    //
+    // Shortest and longest accepted word lengths (longest may be
+    // Unbounded, shortest is Unbounded for the empty language)
+    //
+
+    size_t inline MinLength() const
+    {
+        return MinLength_;
+    }
+
+    size_t inline MaxLength() const
+    {
+        return MaxLength_;
+    }
+};
+
+template <>
+inline CompiledAutomaton::StateId const* CompiledAutomaton::Table<CompiledAutomaton::StateId>() const
+{
+    return Table_.data();
+}
+
+template <>
+inline CompiledAutomaton::NarrowId const* CompiledAutomaton::Table<CompiledAutomaton::NarrowId>() const
+{
+    return NarrowTable_.data();
+}
+
+//
+// States reachable from Initial (visit marks are reset)
+//
+
+std::vector<State*> CollectReachable(State* Initial);
+
+//
+// States from which a finite state is reachable
+//
+
+std::vector<uint8_t> CoReachableStates(CompiledAutomaton const& Automaton);
+
+//
+// Redirects transitions to states that can not reach a finite state
+// to Dead, so that matcher stops as soon as it can no longer accept
+//
+
+CompiledAutomaton TrimDeadStates(CompiledAutomaton const& Automaton);
+
+//
+// Merges equivalent states (Moore partition refinement)
+//
+
+CompiledAutomaton Minimize(CompiledAutomaton const& Automaton);
+
+//
+// Layout passes: states are renumbered so that the ones used together
+// share cache lines of the table. Order[new id] = old id, the initial
+// state stays 0.
+//
+
+CompiledAutomaton Renumber(CompiledAutomaton const& Automaton, std::vector<CompiledAutomaton::StateId> const& Order);
+
+//
+// Breadth-first from the initial state, columns in order
+//
+
+CompiledAutomaton RenumberBreadthFirst(CompiledAutomaton const& Automaton);
+
+//
+// Steps into every state while scanning the samples as SolveTask13 does
+//
+
+std::vector<uint64_t> CountVisits(CompiledAutomaton const& Automaton, std::vector<std::string_view> const& Samples);
+
+//
+// Most visited first (ties and unvisited ones breadth-first)
+//
+
+CompiledAutomaton RenumberByVisits(CompiledAutomaton const& Automaton, std::vector<uint64_t> const& Visits);
+
+CompiledAutomaton CompileRegexp(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
@@ -0,0 +1,53 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Determinize.h
+
+Abstract:
+
+    Parallel subset construction.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <string>
+#include <Common.h>
+#include <Compiled.h>
+#include <Nfa.h>
+
+//
+// Definitions
+//
+
+//
+// Works on CompiledNfa, since States come from a thread-local allocator.
+// The result is the same for any threads count.
+//
+// Threads == 0 means std::thread::hardware_concurrency(), the calling
+// thread is one of the workers. Every worker honours DFSM states, bytes
+// and deadline limits of the Budget of the calling thread, the first
+// exception of any worker is rethrown.
+//
+
+CompiledAutomaton DeterminizeParallel(CompiledNfa const& Nfa, size_t Threads = 0);
+
+CompiledAutomaton CompileRegexpParallel
+(
+    std::string const& ReversePolishRegexp,
+    AlphabetType const& Alphabet,
+    size_t Threads = 0
+);
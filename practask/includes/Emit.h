@@ -0,0 +1,49 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Emit.h
+
+Abstract:
+
+    DFSM to C++ code generator.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <ostream>
+#include <string>
+#include <Compiled.h>
+
+//
+// Definitions
+//
+
+//
+// Every state becomes a label with a switch on the next symbol, so
+// matching does no table loads. Emitted function has the signature of
+// the library matcher (regsolver_match without the handle):
+//
+//     size_t FunctionName(char const* Word, size_t WordLength);
+//
+
+void EmitCpp
+(
+    CompiledAutomaton const& Automaton,
+    std::string const& FunctionName,
+    std::ostream& Stream,
+    std::string const& Comment = ""
+);
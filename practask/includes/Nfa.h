@@ -0,0 +1,255 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Nfa.h
+
+Abstract:
+
+    Epsilon-free NDFSM table and its matchers.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Common.h>
+#include <Automaton.h>
+
+//
+// Definitions
+//
+
+class CompiledNfa
+{
+public:
+    using StateId = uint32_t;
+
+    struct TargetRange
+    {
+        StateId const* Begin, * End;
+
+        StateId const* begin() const
+        {
+            return Begin;
+        }
+
+        StateId const* end() const
+        {
+            return End;
+        }
+    };
+
+protected:
+    std::string Symbols_;
+    std::array<int16_t, 256> Columns_;
+    std::vector<uint32_t> Offsets_;
+    std::vector<StateId> Targets_;
+    std::vector<uint8_t> Finite_;
+
+public:
+    CompiledNfa();
+
+    //
+    // Nfsm must have no epsilon transitions, Nfsm.Initial becomes state 0
+    //
+
+    static CompiledNfa FromNfsm(Automaton Nfsm, AlphabetType const& Alphabet);
+
+    StateId inline Initial() const
+    {
+        return 0;
+    }
+
+    size_t inline StatesCount() const
+    {
+        return Finite_.size();
+    }
+
+    size_t inline AlphabetSize() const
+    {
+        return Symbols_.size();
+    }
+
+    std::string const& Symbols() const
+    {
+        return Symbols_;
+    }
+
+    //
+    // -1 for symbols not from the alphabet
+    //
+
+    int inline Column(char Sym) const
+    {
+        return Columns_[uint8_t(Sym)];
+    }
+
+    TargetRange inline Targets(StateId From, size_t Column) const
+    {
+        auto cell = From * Symbols_.size() + Column;
+        return { Targets_.data() + Offsets_[cell], Targets_.data() + Offsets_[cell + 1] };
+    }
+
+    bool inline Finite(StateId State) const
+    {
+        return Finite_[State];
+    }
+};
+
+CompiledNfa CompileNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet);
+
+//
+// One pass, earliest start kept per live state. Every Solve* here
+// returns the same answer as SolveTask13
+//
+
+size_t SolveNfa(CompiledNfa const& Nfa, std::string_view Word);
+
+// ******************************************************
+//                      Lazy DFSM
+// ******************************************************
+
+//
+// Subsets are built on demand, the cache of them is bounded
+//
+
+class LazyDfsm
+{
+public:
+    using StateId = uint32_t;
+    static constexpr StateId Dead = UINT32_MAX;
+    static constexpr StateId Unknown = UINT32_MAX - 1;
+
+protected:
+    CompiledNfa const& Nfa_;
+    size_t MaxStates_;
+    size_t Flushes_ = 0;
+
+    std::map<std::vector<CompiledNfa::StateId>, StateId> Ids_;
+    std::vector<std::vector<CompiledNfa::StateId>> Sets_;
+    std::vector<StateId> Table_;
+    std::vector<uint8_t> Finite_;
+
+    StateId Intern(std::vector<CompiledNfa::StateId> Set);
+    StateId Compute(StateId From, size_t Column);
+    void Flush();
+
+public:
+    //
+    // Cache is dropped (and rebuilt on demand) when it reaches MaxStates
+    //
+
+    explicit LazyDfsm(CompiledNfa const& Nfa, size_t MaxStates = 4096);
+
+    StateId inline Initial() const
+    {
+        return 0;
+    }
+
+    StateId inline Step(StateId From, char Sym)
+    {
+        auto column = Nfa_.Column(Sym);
+        if (column < 0)
+            return Dead;
+
+        auto to = Table_[From * Nfa_.AlphabetSize() + column];
+        return (to != Unknown) ? to : Compute(From, size_t(column));
+    }
+
+    bool inline Finite(StateId State) const
+    {
+        return Finite_[State];
+    }
+
+    size_t inline StatesCount() const
+    {
+        return Sets_.size();
+    }
+
+    size_t inline Flushes() const
+    {
+        return Flushes_;
+    }
+};
+
+size_t SolveLazyDfsm(CompiledNfa const& Nfa, std::string_view Word);
+
+// ******************************************************
+//                  Bit-parallel NDFSM
+// ******************************************************
+
+//
+// State set in a machine word (up to MaxStates states)
+//
+
+class BitParallelNfa
+{
+public:
+    using StateSet = uint64_t;
+    static constexpr StateSet Dead = 0;
+    static constexpr size_t MaxStates = 64;
+
+protected:
+    std::array<int16_t, 256> Columns_;
+    size_t Chunks_ = 0;
+    StateSet FiniteMask_ = 0;
+
+    //
+    // [(column * Chunks_ + chunk) * 256 + byte of the set]: union of
+    // the targets of the 8 states the byte stands for
+    //
+
+    std::vector<StateSet> Follow_;
+
+public:
+    //
+    // Throws std::runtime_error if Nfa has more than MaxStates states
+    //
+
+    explicit BitParallelNfa(CompiledNfa const& Nfa);
+
+    StateSet inline Initial() const
+    {
+        return 1;
+    }
+
+    StateSet inline Step(StateSet From, char Sym) const
+    {
+        auto column = Columns_[uint8_t(Sym)];
+        if (column < 0)
+            return Dead;
+
+        auto follow = Follow_.data() + size_t(column) * Chunks_ * 256;
+        StateSet to = 0;
+
+        for (size_t chunk = 0; chunk != Chunks_; chunk++, From >>= 8)
+            to |= follow[chunk * 256 + (From & 0xFF)];
+
+        return to;
+    }
+
+    bool inline Finite(StateSet Set) const
+    {
+        return (Set & FiniteMask_) != 0;
+    }
+};
+
+size_t SolveBitParallel(CompiledNfa const& Nfa, std::string_view Word);
@@ -37,4 +37,45 @@ using DeltaType = std::map<State*, State::StatesContainer>;
 //
 
 Automaton RemoveEpsilonTransitions(Automaton Automaton);
-Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet);
\ No newline at end of file
+Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet);
+
+//
+// Subset construction straight on the Thompson NDFSM: epsilon closures
+// are computed on demand (once per state) instead of contracting them
+// into transitions of an intermediate epsilon-free NDFSM
+//
+
+Automaton ThompsonToDfsm(Automaton Auto, AlphabetType const& Alphabet);
+
+//
+// Disconnects states from which no finite state is reachable,
+// missing transitions lead to the canonical dead state
+//
+
+Automaton RemoveUselessStates(Automaton Auto);
+
+//
+// Frees every allocated state not reachable from Auto.Initial (states
+// orphaned by the previous phase), so that the next phase pays for the
+// live automaton only
+//
+
+Automaton CompactStates(Automaton Auto);
+struct ReductionStats
+{
+    size_t StatesBefore = 0;
+    size_t StatesAfter = 0;
+    size_t TransitionsBefore = 0;
+    size_t TransitionsAfter = 0;
+};
+
+//
+// Merges NDFSM states behaving identically: forward bisimilar ones
+// (same finiteness, transitions by the same symbols into the same
+// classes) and backward bisimilar ones (both initial or not, reached by
+// the same symbols from the same classes), until neither merges any.
+// Keeps the language; Eps is just one more label. Merged states are
+// new, the old ones are left for CompactStates.
+//
+
+Automaton ReduceBisimilar(Automaton Auto, ReductionStats* Stats = nullptr);
@@ -0,0 +1,127 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    PatternSet.h
+
+Abstract:
+
+    Several regexps over the same alphabet matched in one scan.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Common.h>
+#include <Compiled.h>
+
+//
+// Definitions
+//
+
+class PatternSet
+{
+public:
+    using StateId = CompiledAutomaton::StateId;
+    using PatternMask = uint64_t;
+
+    static constexpr StateId Dead = CompiledAutomaton::Dead;
+    static constexpr size_t GroupPatterns = 64;
+    static constexpr size_t DefaultMaxStates = 1 << 14;
+
+protected:
+    //
+    // Product DFSM of trimmed pattern DFSMs: its state is a tuple of the
+    // pattern states, and it carries the mask of the patterns accepting
+    // there
+    //
+
+    struct Group
+    {
+        //
+        // Bit i of a mask stands for pattern Patterns[i]
+        //
+
+        std::vector<size_t> Patterns;
+        std::vector<size_t> MaxLengths;
+        std::vector<StateId> Table;
+        std::vector<PatternMask> Accepts;
+    };
+
+    std::string Symbols_;
+    std::array<int16_t, 256> Columns_;
+    std::vector<Group> Groups_;
+    size_t PatternsCount_ = 0;
+
+    bool BuildGroup
+    (
+        std::vector<CompiledAutomaton> const& Automata,
+        std::vector<size_t> const& Patterns,
+        size_t MaxStates
+    );
+
+    void AddGroup
+    (
+        std::vector<CompiledAutomaton> const& Automata,
+        std::vector<size_t> Patterns,
+        size_t MaxStates
+    );
+
+    PatternSet();
+
+public:
+    //
+    // Product may grow as the product of the pattern DFSMs. A group whose
+    // product exceeds MaxStates is split in halves, so a single pattern
+    // always fits. A group holds at most GroupPatterns patterns
+    //
+
+    static PatternSet Compile
+    (
+        std::vector<std::string> const& ReversePolishRegexps,
+        AlphabetType const& Alphabet,
+        size_t MaxStates = DefaultMaxStates
+    );
+
+    size_t inline PatternsCount() const
+    {
+        return PatternsCount_;
+    }
+
+    size_t inline GroupsCount() const
+    {
+        return Groups_.size();
+    }
+
+    //
+    // Product states of all the groups
+    //
+
+    size_t StatesCount() const;
+
+    //
+    // Longest accepted substring of the word for every pattern,
+    // same as SolveTask13 for each of them. Every start is run once
+    // through the products, and a pattern whose longest accepted word
+    // is found drops out of the mask
+    //
+
+    std::vector<size_t> Solve(std::string_view Word) const;
+};
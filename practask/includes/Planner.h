@@ -0,0 +1,154 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Planner.h
+
+Abstract:
+
+    Execution engine choice per query.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <Common.h>
+#include <Cache.h>
+
+//
+// Definitions
+//
+
+//
+// Cost of every engine is estimated from the regexp shape (Thompson
+// NDFSM size, star nesting, union fan-out) and the word length:
+//
+//     Dfsm         -- full determinization, cheapest step; pays off for
+//                     long words unless the DFSM blows up
+//     LazyDfsm     -- determinizes only the subsets the word visits
+//     Nfa          -- one linear pass, step costs the live states
+//     BitParallel  -- no construction at all, for tiny NDFSMs / words
+//
+
+enum class Engine
+{
+    Dfsm,
+    LazyDfsm,
+    Nfa,
+    BitParallel,
+};
+
+size_t const EnginesCount = 4;
+
+char const* EngineName(Engine Kind);
+
+struct RegexpShape
+{
+    size_t ThompsonStates = 0;
+    size_t Symbols = 0;
+    size_t StarDepth = 0;
+
+    //
+    // Most alternatives of a single union
+    //
+
+    size_t UnionFanout = 1;
+
+    //
+    // log2 of the DFSM blowup estimate: union alternatives
+    // concatenated after a starred subexpression
+    //
+
+    size_t Branching = 0;
+
+    //
+    // Distinct symbols a nonempty accepted word may start with
+    //
+
+    size_t FirstSymbols = 0;
+};
+
+//
+// Does not validate the regexp: malformed one fails in the engine
+//
+
+RegexpShape AnalyzeShape(std::string const& ReversePolishRegexp);
+
+struct QueryPlan
+{
+    Engine Chosen = Engine::Dfsm;
+    RegexpShape Shape;
+    std::array<double, EnginesCount> Costs = {};
+
+    //
+    // Chosen engine ran out of Budget and Nfa answered instead
+    //
+
+    bool FellBack = false;
+};
+
+//
+// DfsmCached / NfaCached -- compiled automaton is already in the cache,
+// so the engines using it do not pay for construction. Dfsm estimated
+// to exceed the DFSM states limit of the current Budget is not chosen.
+//
+
+QueryPlan PlanQuery
+(
+    std::string const& ReversePolishRegexp,
+    size_t AlphabetSize,
+    size_t WordLength,
+    bool DfsmCached = false,
+    bool NfaCached = false
+);
+
+//
+// Automata are taken from Cache (compiled every time if Cache is null)
+//
+
+size_t SolveWithEngine
+(
+    Engine Kind,
+    std::string const& ReversePolishRegexp,
+    std::string_view Word,
+    AlphabetType const& Alphabet,
+    AutomataCache* Cache = nullptr
+);
+
+//
+// Dfsm running out of DFSM states or memory falls back to Nfa, which
+// builds no subsets. Otherwise BudgetExceeded is rethrown.
+//
+
+size_t RunPlan
+(
+    QueryPlan& Plan,
+    std::string const& ReversePolishRegexp,
+    std::string_view Word,
+    AlphabetType const& Alphabet,
+    AutomataCache* Cache = nullptr
+);
+
+size_t SolvePlanned
+(
+    std::string const& ReversePolishRegexp,
+    std::string_view Word,
+    AlphabetType const& Alphabet,
+    AutomataCache* Cache = nullptr,
+    QueryPlan* Plan = nullptr
+);
@@ -0,0 +1,120 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Protocol.h
+
+Abstract:
+
+    regsolver server protocol definitions.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <Budget.h>
+
+//
+// Definitions
+//
+
+//
+// Integers are in host byte order, since only Unix domain sockets are
+// supported. Every message is a frame:
+//
+//     u32 length, then length bytes of body.
+//
+// Request body:
+//     'Q' str regexp, str alphabet, str word     -- solve query
+//     'S'                                        -- stats report
+// where str is u32 length followed by its bytes.
+//
+// Response body:
+//     'O' u64 answer                             -- query solved
+//     'O' text                                   -- stats report
+//     'E' text                                   -- error message
+//     'B' u8 resource                            -- query exceeded its
+//                                                   budget, resource is
+//                                                   BudgetExceeded::Resource
+//
+
+enum
+{
+    REQUEST_QUERY = 'Q',
+    REQUEST_STATS = 'S',
+    RESPONSE_OK = 'O',
+    RESPONSE_ERROR = 'E',
+    RESPONSE_BUDGET = 'B',
+};
+
+size_t const MaxFrameLength = 64 << 20;
+
+struct Query
+{
+    std::string Regexp;
+    std::string Alphabet;
+    std::string Word;
+};
+
+//
+// ReadFrame returns false on clean EOF before the frame,
+// both throw std::runtime_error on I/O errors
+//
+
+bool ReadFrame(int Fd, std::string& Frame);
+void WriteFrame(int Fd, std::string_view Frame);
+
+//
+// Moves the first complete frame out of bytes received so far,
+// returns false if Buffer does not hold one yet
+//
+
+bool TakeFrame(std::string& Buffer, std::string& Frame);
+
+std::string EncodeQuery(std::string_view Regexp, std::string_view Alphabet, std::string_view Word);
+Query DecodeQuery(std::string_view Frame);
+
+std::string EncodeAnswer(uint64_t Answer);
+std::string EncodeBudgetExceeded(BudgetExceeded::Resource Exhausted);
+
+//
+// Throws BudgetExceeded on RESPONSE_BUDGET, std::runtime_error on errors
+//
+
+uint64_t DecodeAnswer(std::string_view Frame);
+
+int ConnectUnixSocket(std::string const& Path);
+
+class Client
+{
+protected:
+    int Fd_ = -1;
+    std::string Frame_;
+
+    std::string_view Exchange(std::string_view Request);
+
+public:
+    explicit Client(std::string const& Path);
+    ~Client();
+
+    Client(Client const&) = delete;
+    Client& operator=(Client const&) = delete;
+
+    uint64_t Solve(std::string_view Regexp, std::string_view Alphabet, std::string_view Word);
+    std::string Stats();
+};
@@ -28,6 +28,8 @@ Revision History:
 //
 
 
+#include <string>
+#include <vector>
 #include <Common.h>
 #include <Automaton.h>
 
@@ -49,4 +51,19 @@ Automaton CreateConcat(Automaton First, Automaton Second);
 Automaton CreateUnion(Automaton First, Automaton Second);
 Automaton CreateKleene(Automaton Source);
 
+//
+// Union of the words as a trie, every word end goes to the single
+// finite state by Eps. Linear in the total length of the words.
+//
+
+Automaton CreateTrie(std::vector<std::string> const& Words);
+
+//
+// Unions of at least LiteralUnionMinWords literal words are lowered
+// by CreateTrie instead of nesting CreateUnion (see Ast.h), the parser
+// below builds every operator as written
+//
+
+size_t const LiteralUnionMinWords = 8;
+
 Automaton ParseReversePolishRegexp(std::string Regexp, AlphabetType const& alphabet);
\ No newline at end of file
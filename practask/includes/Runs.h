@@ -0,0 +1,154 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Runs.h
+
+Abstract:
+
+    Run-length encoded words.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <Compiled.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+struct SymbolRun
+{
+    char Sym = 0;
+    size_t Length = 0;
+};
+
+using RunLengthWord = std::vector<SymbolRun>;
+
+RunLengthWord EncodeRuns(std::string_view Word);
+
+//
+// FindLongestMatch switches to runs for the words at least RunsMinLength
+// long with at least RunsMinAverage symbols per run on average
+//
+
+size_t const RunsMinLength = 4096;
+size_t const RunsMinAverage = 16;
+
+bool PreferRuns(std::string_view Word);
+
+//
+// States reached from a state by repeating one symbol form a path which
+// ends in a cycle (Dead is a cycle of its own). The path is found once
+// per state and symbol, then a run of any length costs at most the path
+// length instead of a step per symbol
+//
+
+class RunPowers
+{
+public:
+    using StateId = CompiledAutomaton::StateId;
+
+protected:
+    //
+    // Path[k] is the state after k repetitions, Path[CycleBegin..]
+    // repeats forever. States of the path are distinct.
+    //
+
+    struct Orbit
+    {
+        std::vector<StateId> Path;
+        size_t CycleBegin = 0;
+    };
+
+    CompiledAutomaton const& Automaton_;
+    std::unordered_map<uint64_t, Orbit> Orbits_;
+
+    //
+    // Index in the path being built, NotSeen outside of it
+    //
+
+    static constexpr size_t NotSeen = SIZE_MAX;
+    std::vector<size_t> Seen_;
+
+    Orbit const& Of(StateId From, char Sym);
+
+public:
+    RunPowers(CompiledAutomaton const& Automaton);
+
+    StateId After(StateId From, char Sym, size_t Repeats);
+
+    //
+    // Largest k in [1, Repeats] such that the state after k repetitions
+    // is finite, 0 if none
+    //
+
+    size_t LastFinite(StateId From, char Sym, size_t Repeats);
+
+    //
+    // Calls Visit(State, Repeats) for every distinct state reached after
+    // 1..MaxRepeats repetitions, with the largest such Repeats
+    //
+
+    template <typename Callback>
+    void ForEachLast(StateId From, char Sym, size_t MaxRepeats, Callback Visit)
+    {
+        auto const& orbit = Of(From, Sym);
+        auto cycle = orbit.Path.size() - orbit.CycleBegin;
+
+        for (size_t idx = 1; idx < orbit.Path.size() && idx <= MaxRepeats; idx++)
+        {
+            auto repeats = idx;
+            if (idx >= orbit.CycleBegin)
+                repeats += (MaxRepeats - idx) / cycle * cycle;
+
+            Visit(orbit.Path[idx], repeats);
+        }
+
+        //
+        // Initial state on the cycle is reached again
+        //
+
+        if (orbit.CycleBegin == 0 && cycle <= MaxRepeats)
+            Visit(orbit.Path[0], MaxRepeats / cycle * cycle);
+    }
+};
+
+//
+// A start inside a run only matters by the state it leaves the run in,
+// so only the leftmost start of every such state is tried, and the
+// longest extension of a state through the following runs is memoized
+//
+
+std::optional<MatchSpan> FindLongestMatch
+(
+    CompiledAutomaton const& Automaton,
+    RunLengthWord const& Runs,
+    MatchStats* Stats = nullptr
+);
+
+size_t SolveTask13
+(
+    CompiledAutomaton const& Automaton,
+    RunLengthWord const& Runs,
+    MatchStats* Stats = nullptr
+);
@@ -0,0 +1,85 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Scan.h
+
+Abstract:
+
+    Vectorized search of the first byte from a small set.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//
+// Definitions
+//
+
+class ByteScanner
+{
+protected:
+    std::string Bytes_;
+    std::array<uint8_t, 256> Member_ = {};
+
+    bool Shuffle_ = false;
+    std::array<uint8_t, 16> LowNibbles_ = {};
+    std::array<uint8_t, 16> HighNibbles_ = {};
+
+public:
+    explicit ByteScanner(std::string_view Bytes = "");
+
+    //
+    // Single strategies Find() chooses from, every one falls back to
+    // FindScalar() when it is not available
+    //
+
+    char const* FindScalar(char const* Begin, char const* End) const;
+    char const* FindCompare(char const* Begin, char const* End) const;
+    char const* FindShuffle(char const* Begin, char const* End) const;
+
+    //
+    // CPU supports SSSE3 used by FindShuffle()
+    //
+
+    static bool HasShuffle();
+
+    std::string const& Bytes() const
+    {
+        return Bytes_;
+    }
+
+    bool inline Contains(char Sym) const
+    {
+        return Member_[uint8_t(Sym)];
+    }
+
+    //
+    // First position in [Begin, End) holding a byte from the set, or End:
+    //
+    //     1 byte           -- memchr
+    //     2..4 bytes       -- SSE2 compare of every byte, 16 bytes a step
+    //     up to 8 distinct -- SSSE3 nibble shuffle (if the CPU supports it,
+    //     high nibbles        checked at run time)
+    //     otherwise        -- scalar lookup table
+    //
+
+    char const* Find(char const* Begin, char const* End) const;
+};
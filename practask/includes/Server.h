@@ -0,0 +1,129 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Server.h
+
+Abstract:
+
+    regsolver server over a Unix domain socket (see Protocol.h).
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <Cache.h>
+#include <Protocol.h>
+#include <Stats.h>
+#include <ThreadPool.h>
+
+//
+// Definitions
+//
+
+class Server
+{
+protected:
+    std::string Path_;
+    int Listener_ = -1;
+    std::atomic<bool> Stopping_{false};
+
+    //
+    // Frames of all connections are read by the thread running Serve(),
+    // only answering a request occupies a worker of the pool, so idle
+    // clients do not hold workers. Requests of one connection are
+    // answered one at a time, in order (Busy).
+    //
+    // Input is touched by the Serve() thread only, the rest is
+    // guarded by ConnectionsMutex_
+    //
+
+    struct Connection
+    {
+        std::string Input;
+        bool Busy = false;
+        bool Closing = false;
+    };
+
+    //
+    // Wakes up poll() in Serve(): [0] is read end, [1] is write end
+    //
+
+    int WakePipe_[2] = { -1, -1 };
+
+    //
+    // Out of fds or memory, accept() keeps failing while the listener
+    // stays readable, so the listener is left out of poll() for a while
+    //
+
+    static constexpr std::chrono::milliseconds AcceptPause{100};
+    std::chrono::steady_clock::time_point AcceptPausedUntil_;
+
+    std::mutex ConnectionsMutex_;
+    std::condition_variable NoConnections_;
+    std::map<int, Connection> Connections_;
+    bool Serving_ = false;
+
+    ThreadPool& Pool_;
+    Limits QueryLimits_;
+    AutomataCache Cache_;
+    ServerStats Stats_;
+
+    void Wake();
+    void Accept();
+    int PollTimeout() const;
+    void Receive(int Fd, Connection& Client);
+    void Dispatch(std::vector<pollfd>& Polled);
+    void ServeRequest(int Fd, std::string const& Request);
+    void CloseConnection(int Fd);
+    void CloseConnections();
+    std::string Respond(std::string const& Request);
+
+public:
+    //
+    // Binds the socket (replacing stale socket file) and starts listening,
+    // every query runs under its own Budget of QueryLimits. Compiled
+    // automatons are shared by all connections through the cache
+    //
+
+    Server(std::string Path, ThreadPool& Pool, Limits const& QueryLimits = {},
+           size_t CacheCapacity = AutomataCache::DefaultCapacity);
+    ~Server();
+
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    //
+    // Accepts connections until Stop(), then closes them
+    //
+
+    void Serve();
+
+    //
+    // Async-signal-safe
+    //
+
+    void Stop();
+
+    std::string StatsReport();
+};
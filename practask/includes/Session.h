@@ -0,0 +1,123 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Session.h
+
+Abstract:
+
+    Incremental matching session definition.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <Budget.h>
+#include <Compiled.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+//
+// Receives the word in chunks and keeps the length of the longest
+// accepted substring of everything fed so far
+//
+
+class MatchSession
+{
+public:
+    using StateId = CompiledAutomaton::StateId;
+    static constexpr size_t NoStart = SIZE_MAX;
+
+protected:
+    CompiledAutomaton const& Automaton_;
+
+    //
+    // Earliest start of every live DFSM state: two runs in the same
+    // state behave identically from now on, so the earlier one always
+    // wins, and a step costs O(live states), not O(symbols fed)
+    //
+
+    std::vector<size_t> Start_;
+    std::vector<size_t> NextStart_;
+    std::vector<StateId> Live_;
+    std::vector<StateId> NextLive_;
+
+    size_t Position_ = 0;
+    size_t Longest_ = 0;
+    size_t LongestBegin_ = 0;
+    bool Matched_ = false;
+
+    //
+    // Start of the longest accepted substring ending at Position_
+    // after the step, NoStart if there is none. It is the earliest start
+    // of the finite live states, so the leftmost-longest span and the
+    // per-position matches come from the same pass
+    //
+
+    size_t Step(char Sym);
+
+public:
+    explicit MatchSession(CompiledAutomaton const& Automaton);
+
+    void Append(std::string_view Chunk);
+
+    //
+    // Calls OnEnd(Begin, End) for every position End of the chunk some
+    // accepted substring ends at, [Begin, End) being the longest one
+    //
+
+    template <typename Callback>
+    void Append(std::string_view Chunk, Callback&& OnEnd)
+    {
+        Budget::Tick(Chunk.length());
+
+        for (auto sym : Chunk)
+        {
+            auto begin = Step(sym);
+            if (begin != NoStart)
+                OnEnd(begin, Position_);
+        }
+    }
+
+    void Reset();
+
+    size_t inline Longest() const
+    {
+        return Longest_;
+    }
+
+    //
+    // Leftmost of the longest accepted substrings fed so far
+    //
+
+    std::optional<MatchSpan> inline LongestSpan() const
+    {
+        if (!Matched_)
+            return std::nullopt;
+
+        return MatchSpan{LongestBegin_, LongestBegin_ + Longest_};
+    }
+
+    size_t inline Position() const
+    {
+        return Position_;
+    }
+};
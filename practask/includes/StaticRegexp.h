@@ -0,0 +1,450 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    StaticRegexp.h
+
+Abstract:
+
+    Compile-time regexp compilation for patterns known at build time.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <Regexp.h>
+
+//
+// Definitions
+//
+
+namespace StaticRegexpDetail
+{
+
+size_t constexpr NoColumn = SIZE_MAX;
+
+constexpr size_t Length(char const* String)
+{
+    size_t length = 0;
+    while (String[length] != '\0')
+        length++;
+
+    return length;
+}
+
+constexpr size_t Column(char const* Alphabet, char Sym)
+{
+    for (size_t column = 0; Alphabet[column] != '\0'; column++)
+        if (Alphabet[column] == Sym)
+            return column;
+
+    return NoColumn;
+}
+
+constexpr bool IsSpace(char Sym)
+{
+    return Sym == ' '  || Sym == '\t' || Sym == '\n' ||
+           Sym == '\r' || Sym == '\v' || Sym == '\f';
+}
+
+template <size_t Size>
+struct Set
+{
+    static size_t constexpr Words = (Size + 63) / 64;
+    std::array<uint64_t, Words> Bits{};
+
+    constexpr void Insert(size_t Idx)
+    {
+        Bits[Idx / 64] |= uint64_t(1) << (Idx % 64);
+    }
+
+    constexpr bool Has(size_t Idx) const
+    {
+        return (Bits[Idx / 64] >> (Idx % 64)) & 1;
+    }
+
+    constexpr bool Merge(Set const& Other)
+    {
+        bool changed = false;
+        for (size_t word = 0; word != Words; word++)
+        {
+            auto merged = Bits[word] | Other.Bits[word];
+            changed |= (merged != Bits[word]);
+            Bits[word] = merged;
+        }
+
+        return changed;
+    }
+
+    constexpr bool Empty() const
+    {
+        for (size_t word = 0; word != Words; word++)
+            if (Bits[word] != 0)
+                return false;
+
+        return true;
+    }
+
+    constexpr bool operator==(Set const& Other) const
+    {
+        for (size_t word = 0; word != Words; word++)
+            if (Bits[word] != Other.Bits[word])
+                return false;
+
+        return true;
+    }
+};
+
+//
+// Thompson NDFSM: every state has at most one symbol transition
+//
+
+template <size_t MaxStates>
+struct Nfsm
+{
+    size_t Count = 0;
+    size_t Initial = 0;
+    size_t Finite = 0;
+
+    std::array<Set<MaxStates>, MaxStates> Eps{};
+    std::array<size_t, MaxStates> SymColumn{};
+    std::array<size_t, MaxStates> SymTarget{};
+
+    constexpr size_t Allocate()
+    {
+        SymColumn[Count] = NoColumn;
+        return Count++;
+    }
+};
+
+//
+// Mirrors the Thompson construction of Regexp.cpp. Invalid regexp fails
+// to compile (throw in constant evaluation)
+//
+
+template <size_t MaxStates>
+constexpr Nfsm<MaxStates> Parse(char const* Regexp, char const* Alphabet)
+{
+    Nfsm<MaxStates> nfsm;
+    std::array<size_t, MaxStates> initials{};
+    std::array<size_t, MaxStates> finites{};
+    size_t top = 0;
+
+    for (size_t idx = 0; Regexp[idx] != '\0'; idx++)
+    {
+        auto sym = Regexp[idx];
+        if (IsSpace(sym))
+            continue;
+
+        if (sym == SYM_ONE)
+        {
+            auto initial = nfsm.Allocate();
+            auto finite = nfsm.Allocate();
+            nfsm.Eps[initial].Insert(finite);
+
+            initials[top] = initial;
+            finites[top++] = finite;
+        }
+
+        else if (sym == SYM_KLEENE)
+        {
+            if (top < 1)
+                throw std::runtime_error("No operand for Kleene star");
+
+            auto single = nfsm.Allocate();
+            nfsm.Eps[single].Insert(initials[top - 1]);
+            nfsm.Eps[finites[top - 1]].Insert(single);
+
+            initials[top - 1] = single;
+            finites[top - 1] = single;
+        }
+
+        else if (sym == SYM_CONCAT)
+        {
+            if (top < 2)
+                throw std::runtime_error("Not enough operands for concatenation");
+
+            nfsm.Eps[finites[top - 2]].Insert(initials[top - 1]);
+            finites[top - 2] = finites[top - 1];
+            top--;
+        }
+
+        else if (sym == SYM_UNION)
+        {
+            if (top < 2)
+                throw std::runtime_error("Not enough operands for union");
+
+            auto initial = nfsm.Allocate();
+            auto finite = nfsm.Allocate();
+
+            nfsm.Eps[initial].Insert(initials[top - 2]);
+            nfsm.Eps[initial].Insert(initials[top - 1]);
+            nfsm.Eps[finites[top - 2]].Insert(finite);
+            nfsm.Eps[finites[top - 1]].Insert(finite);
+
+            initials[top - 2] = initial;
+            finites[top - 2] = finite;
+            top--;
+        }
+
+        else
+        {
+            auto column = Column(Alphabet, sym);
+            if (column == NoColumn)
+                throw std::runtime_error("Invalid symbol");
+
+            auto initial = nfsm.Allocate();
+            auto finite = nfsm.Allocate();
+            nfsm.SymColumn[initial] = column;
+            nfsm.SymTarget[initial] = finite;
+
+            initials[top] = initial;
+            finites[top++] = finite;
+        }
+    }
+
+    if (top != 1)
+        throw std::runtime_error("Extra expressions left in stack after regular expression parsing");
+
+    nfsm.Initial = initials[0];
+    nfsm.Finite = finites[0];
+    return nfsm;
+}
+
+template <size_t MaxStates>
+constexpr std::array<Set<MaxStates>, MaxStates> EpsClosures(Nfsm<MaxStates> const& Nfsm)
+{
+    std::array<Set<MaxStates>, MaxStates> closures{};
+    for (size_t state = 0; state != Nfsm.Count; state++)
+    {
+        closures[state] = Nfsm.Eps[state];
+        closures[state].Insert(state);
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t state = 0; state != Nfsm.Count; state++)
+            for (size_t reachable = 0; reachable != Nfsm.Count; reachable++)
+                if (reachable != state && closures[state].Has(reachable))
+                    changed |= closures[state].Merge(closures[reachable]);
+    }
+
+    return closures;
+}
+
+//
+// Dead transitions lead to MaxStates
+//
+
+template <size_t MaxStates, size_t AlphabetSize>
+struct Dfsm
+{
+    size_t Count = 0;
+    bool Overflow = false;
+
+    std::array<std::array<size_t, AlphabetSize>, MaxStates> Table{};
+    std::array<bool, MaxStates> Finite{};
+};
+
+//
+// Epsilon transitions are removed by closing every subset
+//
+
+template <size_t MaxDfsm, size_t AlphabetSize, size_t MaxNfsm>
+constexpr Dfsm<MaxDfsm, AlphabetSize> Determinize(Nfsm<MaxNfsm> const& Nfsm)
+{
+    auto closures = EpsClosures(Nfsm);
+
+    Dfsm<MaxDfsm, AlphabetSize> dfsm;
+    std::array<Set<MaxNfsm>, MaxDfsm> subsets{};
+    subsets[0] = closures[Nfsm.Initial];
+    dfsm.Count = 1;
+
+    for (size_t current = 0; current != dfsm.Count; current++)
+    {
+        dfsm.Finite[current] = subsets[current].Has(Nfsm.Finite);
+
+        for (size_t column = 0; column != AlphabetSize; column++)
+        {
+            Set<MaxNfsm> to{};
+            for (size_t state = 0; state != Nfsm.Count; state++)
+                if (subsets[current].Has(state) && Nfsm.SymColumn[state] == column)
+                    to.Merge(closures[Nfsm.SymTarget[state]]);
+
+            dfsm.Table[current][column] = MaxDfsm;
+            if (to.Empty())
+                continue;
+
+            size_t found = 0;
+            while (found != dfsm.Count && !(subsets[found] == to))
+                found++;
+
+            if (found == dfsm.Count)
+            {
+                if (dfsm.Count == MaxDfsm)
+                {
+                    dfsm.Overflow = true;
+                    return dfsm;
+                }
+
+                subsets[dfsm.Count++] = to;
+            }
+
+            dfsm.Table[current][column] = found;
+        }
+    }
+
+    return dfsm;
+}
+
+//
+// Last column is for symbols out of the alphabet
+//
+
+template <typename StateType, size_t StatesCount, size_t AlphabetSize, size_t MaxDfsm>
+constexpr auto MakeTable(Dfsm<MaxDfsm, AlphabetSize> const& Dfsm)
+{
+    std::array<std::array<StateType, AlphabetSize + 1>, StatesCount> table{};
+    for (size_t state = 0; state != StatesCount; state++)
+    {
+        for (size_t column = 0; column != AlphabetSize; column++)
+        {
+            auto to = Dfsm.Table[state][column];
+            table[state][column] = (to == MaxDfsm) ? StateType(~StateType(0)) : StateType(to);
+        }
+
+        table[state][AlphabetSize] = StateType(~StateType(0));
+    }
+
+    return table;
+}
+
+template <size_t StatesCount, size_t AlphabetSize, size_t MaxDfsm>
+constexpr auto MakeFinite(Dfsm<MaxDfsm, AlphabetSize> const& Dfsm)
+{
+    std::array<bool, StatesCount> finite{};
+    for (size_t state = 0; state != StatesCount; state++)
+        finite[state] = Dfsm.Finite[state];
+
+    return finite;
+}
+
+template <typename ColumnType, size_t AlphabetSize>
+constexpr auto MakeColumns(char const* Alphabet)
+{
+    std::array<ColumnType, 256> columns{};
+    for (size_t sym = 0; sym != 256; sym++)
+    {
+        auto column = Column(Alphabet, char(sym));
+        columns[sym] = ColumnType(column == NoColumn ? AlphabetSize : column);
+    }
+
+    return columns;
+}
+
+} // namespace StaticRegexpDetail
+
+//
+// Transition table is a static constexpr array, and the matcher is
+// specialized on states count and alphabet size:
+//
+//     static constexpr char Pattern[] = "ab+c.aba.*.bac.+.+*1+";
+//     static constexpr char Abc[] = "abc";
+//     using Matcher = StaticRegexp<Pattern, Abc>;
+//
+//     Matcher::Solve("babc");     // 2, same as SolveTask13
+//
+// Intended for small patterns: constant evaluation is bounded by
+// compiler limits, and MaxDfsm bounds the DFSM size
+//
+
+template <char const* Regexp, char const* Alphabet, size_t MaxDfsm = 64>
+class StaticRegexp
+{
+protected:
+    static size_t constexpr MaxNfsm = 2 * StaticRegexpDetail::Length(Regexp) + 1;
+
+public:
+    static size_t constexpr AlphabetSize = StaticRegexpDetail::Length(Alphabet);
+
+protected:
+    static constexpr auto Dfsm_ =
+        StaticRegexpDetail::Determinize<MaxDfsm, AlphabetSize>(
+            StaticRegexpDetail::Parse<MaxNfsm>(Regexp, Alphabet));
+
+    static_assert(!Dfsm_.Overflow, "DFSM has more than MaxDfsm states");
+
+public:
+    static size_t constexpr StatesCount = Dfsm_.Count;
+
+    using StateType = std::conditional_t<(StatesCount < UINT8_MAX), uint8_t,
+                      std::conditional_t<(StatesCount < UINT16_MAX), uint16_t, uint32_t>>;
+
+    using ColumnType = std::conditional_t<(AlphabetSize < UINT8_MAX), uint8_t, uint16_t>;
+
+    static StateType constexpr Dead = StateType(~StateType(0));
+
+    static constexpr auto Table =
+        StaticRegexpDetail::MakeTable<StateType, StatesCount>(Dfsm_);
+
+    static constexpr auto Finite =
+        StaticRegexpDetail::MakeFinite<StatesCount>(Dfsm_);
+
+    static constexpr auto Columns =
+        StaticRegexpDetail::MakeColumns<ColumnType, AlphabetSize>(Alphabet);
+
+    static inline size_t TryAccept(char const* Begin, char const* End)
+    {
+        size_t maxAcceptedPrefixLen = 0;
+        StateType current = 0;
+
+        for (auto position = Begin; position != End; position++)
+        {
+            current = Table[current][Columns[uint8_t(*position)]];
+            if (current == Dead)
+                break;
+
+            if (Finite[current])
+                maxAcceptedPrefixLen = size_t(position - Begin) + 1;
+        }
+
+        return maxAcceptedPrefixLen;
+    }
+
+    static size_t Solve(std::string_view Word)
+    {
+        size_t maxAcceptedSubstrLen = 0;
+        size_t symbolsLeft = Word.length();
+        auto end = Word.data() + Word.length();
+
+        for (auto current = Word.data(); current != end; current++, symbolsLeft--)
+        {
+            if (maxAcceptedSubstrLen >= symbolsLeft)
+                break;
+
+            maxAcceptedSubstrLen = std::max(maxAcceptedSubstrLen, TryAccept(current, end));
+        }
+
+        return maxAcceptedSubstrLen;
+    }
+};
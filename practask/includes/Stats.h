@@ -0,0 +1,78 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Stats.h
+
+Abstract:
+
+    Lock-free counters for server statistics.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <Planner.h>
+
+//
+// Definitions
+//
+
+//
+// Bucket k counts latencies in [2^(k - 1), 2^k) microseconds,
+// bucket 0 counts latencies below 1us
+//
+
+class LatencyHistogram
+{
+public:
+    static size_t const Buckets = 32;
+
+protected:
+    std::array<std::atomic<uint64_t>, Buckets> Counts_ = {};
+
+public:
+    void Record(std::chrono::nanoseconds Latency);
+
+    uint64_t Total() const;
+
+    //
+    // Upper bound of the bucket containing the Quantile, in microseconds
+    //
+
+    uint64_t QuantileUs(double Quantile) const;
+
+    void Report(std::ostream& Stream) const;
+};
+
+struct ServerStats
+{
+    std::atomic<uint64_t> Requests{0};
+    std::atomic<uint64_t> Errors{0};
+    std::atomic<uint64_t> OverBudget{0};
+    std::atomic<uint64_t> Fallbacks{0};
+    LatencyHistogram Latency;
+
+    //
+    // Queries per engine chosen by the planner
+    //
+
+    std::array<std::atomic<uint64_t>, EnginesCount> Engines = {};
+};
@@ -0,0 +1,228 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Tables.h
+
+Abstract:
+
+    Alternative transition table layouts of a compiled DFSM.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include <Compiled.h>
+
+//
+// Definitions
+//
+
+//
+// For the DFSMs whose dense table does not fit into the cache. Id is
+// uint16_t when the states count permits (halves the table) or uint32_t
+//
+
+//
+// [state * symbols + column], as CompiledAutomaton
+//
+
+template <typename Id>
+class DenseTable
+{
+public:
+    using StateId = Id;
+    static constexpr StateId Dead = std::numeric_limits<Id>::max();
+
+protected:
+    std::array<int16_t, 256> Columns_;
+    size_t AlphabetSize_ = 0;
+    std::vector<StateId> Table_;
+    std::vector<uint8_t> Finite_;
+
+    size_t MinLength_ = 0;
+    size_t MaxLength_ = 0;
+
+public:
+    //
+    // Throws if the states do not fit into Id
+    //
+
+    static DenseTable FromCompiled(CompiledAutomaton const& Automaton);
+
+    StateId inline Initial() const
+    {
+        return 0;
+    }
+
+    StateId inline Step(StateId From, char Sym) const
+    {
+        auto column = Columns_[uint8_t(Sym)];
+        if (column < 0)
+            return Dead;
+
+        return Table_[From * AlphabetSize_ + size_t(column)];
+    }
+
+    bool inline Finite(StateId State) const
+    {
+        return Finite_[State];
+    }
+
+    size_t inline MinLength() const
+    {
+        return MinLength_;
+    }
+
+    size_t inline MaxLength() const
+    {
+        return MaxLength_;
+    }
+
+    size_t TableBytes() const
+    {
+        return Table_.size() * sizeof(StateId);
+    }
+};
+
+//
+// Row displacement (comb vector): every state has its default target
+// and a base. The other transitions of all rows are packed into one
+// vector of slots, slot Base + column belongs to the state iff its
+// Check says so
+//
+
+template <typename Id>
+class CombTable
+{
+public:
+    using StateId = Id;
+    static constexpr StateId Dead = std::numeric_limits<Id>::max();
+
+protected:
+    //
+    // A step touches one row and one slot, so their fields go together
+    //
+
+    struct Row
+    {
+        uint32_t Base;
+        StateId Default;
+    };
+
+    struct Slot
+    {
+        StateId Next;
+
+        //
+        // Owner of the slot, Dead for a free one
+        //
+
+        StateId Check;
+    };
+
+    std::array<int16_t, 256> Columns_;
+    std::vector<Row> Rows_;
+    std::vector<Slot> Slots_;
+    std::vector<uint8_t> Finite_;
+
+    size_t MinLength_ = 0;
+    size_t MaxLength_ = 0;
+
+public:
+    static CombTable FromCompiled(CompiledAutomaton const& Automaton);
+
+    StateId inline Initial() const
+    {
+        return 0;
+    }
+
+    StateId inline Step(StateId From, char Sym) const
+    {
+        auto column = Columns_[uint8_t(Sym)];
+        if (column < 0)
+            return Dead;
+
+        auto const& row = Rows_[From];
+        auto const& slot = Slots_[row.Base + size_t(column)];
+        return (slot.Check == From) ? slot.Next : row.Default;
+    }
+
+    bool inline Finite(StateId State) const
+    {
+        return Finite_[State];
+    }
+
+    size_t inline MinLength() const
+    {
+        return MinLength_;
+    }
+
+    size_t inline MaxLength() const
+    {
+        return MaxLength_;
+    }
+
+    size_t TableBytes() const
+    {
+        return Rows_.size() * sizeof(Row) + Slots_.size() * sizeof(Slot);
+    }
+};
+
+//
+// Same as SolveTask13 (without the prefilter). Templated on the layout,
+// so the step is inlined into the matching loop for each of them
+//
+
+template <typename Table>
+size_t SolveTable(Table const& Automaton, std::string_view Word)
+{
+    if (Automaton.MinLength() == CompiledAutomaton::Unbounded ||
+        Automaton.MinLength() > Word.length())
+        return 0;
+
+    size_t maxAcceptedSubstrLen = 0;
+    auto maxLength = Automaton.MaxLength();
+    auto end = Word.data() + Word.length();
+
+    for (auto current = Word.data(); current != end; current++)
+    {
+        if (maxAcceptedSubstrLen >= size_t(end - current))
+            break;
+
+        auto state = Automaton.Initial();
+        auto window = current + std::min(size_t(end - current), maxLength);
+
+        for (auto position = current; position != window; position++)
+        {
+            state = Automaton.Step(state, *position);
+            if (state == Table::Dead)
+                break;
+
+            if (Automaton.Finite(state))
+                maxAcceptedSubstrLen = std::max(maxAcceptedSubstrLen, size_t(position - current) + 1);
+        }
+
+        if (maxAcceptedSubstrLen == maxLength)
+            break;
+    }
+
+    return maxAcceptedSubstrLen;
+}
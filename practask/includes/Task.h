@@ -24,8 +24,11 @@ Revision History:
 // Includes / usings
 //
 
+#include <optional>
 #include <string>
+#include <string_view>
 #include <Common.h>
+#include <Compiled.h>
 
 //
 // Definitions
@@ -37,10 +40,65 @@ Revision History:
         acb..bab.c.*.ab.ba.+.+*a. abbaa     4
 */
 
+//
+// Throws std::runtime_error on the first symbol not from Alphabet
+//
+
+void CheckWord(std::string_view Word, AlphabetType const& Alphabet);
+
 size_t SolveTask13
 (
     std::string const& ReversePolishRegexp, 
     std::string const& Word, 
     AlphabetType const& Alphabet,
     bool Debug = false
-);
\ No newline at end of file
+);
+
+struct MatchStats
+{
+    size_t Starts = 0;
+    size_t SymbolsStepped = 0;
+};
+
+//
+// Longest accepted prefix of [Begin, End)
+//
+
+size_t TryAcceptTask13
+(
+    CompiledAutomaton const& Automaton,
+    char const* Begin,
+    char const* End,
+    MatchStats* Stats = nullptr
+);
+
+size_t SolveTask13
+(
+    CompiledAutomaton const& Automaton,
+    std::string_view Word,
+    MatchStats* Stats = nullptr
+);
+
+struct MatchSpan
+{
+    size_t Begin = 0;
+    size_t End = 0;
+
+    size_t inline Length() const
+    {
+        return End - Begin;
+    }
+};
+
+//
+// Leftmost of the longest accepted substrings (the pass of SolveTask13),
+// nullopt if no substring, not even the empty one, is accepted. A long
+// word of long runs is matched as runs (see Runs.h).
+//
+
+std::optional<MatchSpan> FindLongestMatch
+(
+    CompiledAutomaton const& Automaton,
+    std::string_view Word,
+    MatchStats* Stats = nullptr
+);
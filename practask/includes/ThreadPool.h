@@ -0,0 +1,80 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    ThreadPool.h
+
+Abstract:
+
+    Fixed-size thread pool definition.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+//
+// Definitions
+//
+
+class ThreadPool
+{
+protected:
+    std::vector<std::thread> Workers_;
+    std::queue<std::function<void()>> Tasks_;
+    std::mutex Mutex_;
+    std::condition_variable HasTasks_;
+    bool Stopping_ = false;
+
+    void Work();
+    void Push(std::function<void()> Task);
+
+public:
+    //
+    // Threads == 0 means std::thread::hardware_concurrency()
+    //
+
+    explicit ThreadPool(size_t Threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    size_t inline Size() const
+    {
+        return Workers_.size();
+    }
+
+    template <typename Function>
+    auto Submit(Function&& Task) -> std::future<decltype(Task())>
+    {
+        using ResultType = decltype(Task());
+
+        auto packaged = std::make_shared<std::packaged_task<ResultType()>>(
+            std::forward<Function>(Task));
+
+        auto future = packaged->get_future();
+        Push([packaged]() { (*packaged)(); });
+        return future;
+    }
+};
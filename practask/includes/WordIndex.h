@@ -0,0 +1,82 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    WordIndex.h
+
+Abstract:
+
+    Suffix automaton of a word, built once and queried by many regexps.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <Compiled.h>
+
+//
+// Definitions
+//
+
+class WordIndex
+{
+public:
+    using StateId = uint32_t;
+    static constexpr StateId Root = 0;
+
+protected:
+    size_t WordLength_ = 0;
+
+    //
+    // Edges of state s are [Offsets_[s], Offsets_[s + 1]), sorted by symbol
+    //
+
+    std::vector<uint32_t> Offsets_;
+    std::vector<char> EdgeSymbols_;
+    std::vector<StateId> EdgeTargets_;
+
+public:
+    //
+    // Linear in the word length (for a fixed alphabet)
+    //
+
+    explicit WordIndex(std::string_view Word);
+
+    size_t inline StatesCount() const
+    {
+        return Offsets_.size() - 1;
+    }
+
+    size_t inline WordLength() const
+    {
+        return WordLength_;
+    }
+
+    bool Contains(std::string_view Substring) const;
+
+    //
+    // Same as SolveTask13(Automaton, Word). Every substring of the word
+    // is spelled by exactly one path from Root, so the answer is the
+    // longest path of the product with the DFSM that ends in a finite
+    // DFSM state. The product is acyclic, best length of every visited
+    // pair is memoized, and only the pairs the DFSM survives are
+    // visited: a handful for a literal-like regexp
+    //
+
+    size_t Solve(CompiledAutomaton const& Automaton) const;
+};
@@ -0,0 +1,127 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    regsolver.h
+
+Abstract:
+
+    C API of libregsolver.
+
+    Example (ctypes):
+        lib = ctypes.CDLL("libregsolver.so")
+        lib.regsolver_compile.restype = ctypes.c_void_p
+        lib.regsolver_match.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]
+        lib.regsolver_free.argtypes = [ctypes.c_void_p]
+
+        handle = lib.regsolver_compile(b"ab+*", 4, b"ab", 2, None)
+        lib.regsolver_match(handle, b"abba", 4)   # 4
+        lib.regsolver_free(handle)
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <stddef.h>
+
+//
+// Definitions
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Compiled regexp is immutable, so one handle may be matched
+    from several threads at once
+*/
+
+typedef struct regsolver_regexp regsolver_regexp;
+
+/*
+    Compiles reverse polish regexp over the alphabet (every byte is
+    a symbol). Returns NULL on failure; then, if Error is not NULL,
+    *Error receives message to be freed by regsolver_free_error.
+*/
+
+regsolver_regexp* regsolver_compile
+(
+    char const* Regexp,
+    size_t RegexpLength,
+    char const* Alphabet,
+    size_t AlphabetLength,
+    char** Error
+);
+
+/*
+    Matching fails only if memory runs out or the calling thread is
+    over its Budget (see Budget.h)
+*/
+
+#define REGSOLVER_MATCH_FAILED ((size_t)-1)
+
+/*
+    Length of the longest substring of the word accepted by regexp,
+    or REGSOLVER_MATCH_FAILED. Words are never copied, symbols not
+    from the alphabet just break every match passing them
+*/
+
+size_t regsolver_match
+(
+    regsolver_regexp const* Handle,
+    char const* Word,
+    size_t WordLength
+);
+
+/*
+    Leftmost of the longest substrings of the word accepted by regexp:
+    returns 1 and stores its offsets to [*Begin, *End), or returns 0
+    if no substring (not even the empty one) is accepted, -1 on failure
+*/
+
+int regsolver_find
+(
+    regsolver_regexp const* Handle,
+    char const* Word,
+    size_t WordLength,
+    size_t* Begin,
+    size_t* End
+);
+
+/*
+    One pass over the word: for every End some accepted substring ends
+    at, calls OnEnd(Context, Begin, End) with [Begin, End) the longest
+    of them. Ends come in increasing order. Returns 0, or -1 on
+    failure (OnEnd may have been called for a prefix of the word).
+*/
+
+typedef void (*regsolver_end_callback)(void* Context, size_t Begin, size_t End);
+
+int regsolver_scan
+(
+    regsolver_regexp const* Handle,
+    char const* Word,
+    size_t WordLength,
+    regsolver_end_callback OnEnd,
+    void* Context
+);
+
+void regsolver_free(regsolver_regexp* Handle);
+void regsolver_free_error(char* Error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,539 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Ast.cpp
+
+Abstract:
+
+    Hash-consed regexp syntax tree implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <cctype>
+#include <stack>
+#include <stdexcept>
+#include <Ast.h>
+#include <Regexp.h>
+
+//
+// Definitions
+//
+
+size_t RegexpAst::KeyHash::operator()(std::vector<uint32_t> const& Key) const
+{
+    size_t hash = Key.size();
+    for (auto value : Key)
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+
+    return hash;
+}
+
+RegexpAst::NodeId RegexpAst::Intern(Kind Type, char Sym, std::vector<NodeId> Children)
+{
+    std::vector<uint32_t> key = { uint32_t(Type), uint32_t(uint8_t(Sym)) };
+    key.insert(key.end(), Children.begin(), Children.end());
+
+    auto found = Interned_.find(key);
+    if (found != Interned_.end())
+        return found->second;
+
+    Node node;
+    node.Type = Type;
+    node.Sym = Sym;
+
+    switch (Type)
+    {
+        case Kind::One:
+        case Kind::Kleene:
+            node.Nullable = true;
+            break;
+
+        case Kind::Symbol:
+            node.Nullable = false;
+            break;
+
+        case Kind::Concat:
+            node.Nullable = std::all_of(Children.begin(), Children.end(),
+                [this](NodeId Child) { return Nodes_[Child].Nullable; });
+            break;
+
+        case Kind::Union:
+            node.Nullable = std::any_of(Children.begin(), Children.end(),
+                [this](NodeId Child) { return Nodes_[Child].Nullable; });
+            break;
+    }
+
+    node.Children = std::move(Children);
+
+    auto id = NodeId(Nodes_.size());
+    Nodes_.push_back(std::move(node));
+    Interned_.emplace(std::move(key), id);
+    return id;
+}
+
+// ******************************************************
+//                 Simplifying constructors
+// ******************************************************
+
+RegexpAst::NodeId RegexpAst::One()
+{
+    return Intern(Kind::One, 0, {});
+}
+
+RegexpAst::NodeId RegexpAst::Symbol(char Sym)
+{
+    return Intern(Kind::Symbol, Sym, {});
+}
+
+RegexpAst::NodeId RegexpAst::Concat(NodeId First, NodeId Second)
+{
+    if (Nodes_[First].Type == Kind::One)
+        return Second;
+
+    if (Nodes_[Second].Type == Kind::One)
+        return First;
+
+    std::vector<NodeId> children;
+    for (auto operand : { First, Second })
+    {
+        if (Nodes_[operand].Type != Kind::Concat)
+        {
+            children.push_back(operand);
+            continue;
+        }
+
+        auto const& nested = Nodes_[operand].Children;
+        children.insert(children.end(), nested.begin(), nested.end());
+    }
+
+    //
+    // r*.r* -> r*, only where the operands meet: each is simplified
+    //
+
+    auto& nodes = Nodes_;
+    children.erase(std::unique(children.begin(), children.end(),
+        [&nodes](NodeId Left, NodeId Right) { return Left == Right && nodes[Left].Type == Kind::Kleene; }),
+        children.end());
+
+    if (children.size() == 1)
+        return children[0];
+
+    return Intern(Kind::Concat, 0, std::move(children));
+}
+
+RegexpAst::NodeId RegexpAst::Union(NodeId First, NodeId Second)
+{
+    std::vector<NodeId> children;
+    for (auto operand : { First, Second })
+        AddAlternatives(operand, children);
+
+    return Union(std::move(children));
+}
+
+void RegexpAst::AddAlternatives(NodeId Source, std::vector<NodeId>& Alternatives) const
+{
+    if (Nodes_[Source].Type != Kind::Union)
+    {
+        Alternatives.push_back(Source);
+        return;
+    }
+
+    auto const& nested = Nodes_[Source].Children;
+    Alternatives.insert(Alternatives.end(), nested.begin(), nested.end());
+}
+
+RegexpAst::NodeId RegexpAst::Union(std::vector<NodeId> Alternatives)
+{
+    auto& children = Alternatives;
+    std::sort(children.begin(), children.end());
+    children.erase(std::unique(children.begin(), children.end()), children.end());
+
+    //
+    // 1 + r -> r for a nullable r
+    //
+
+    auto isOne = [this](NodeId Child) { return Nodes_[Child].Type == Kind::One; };
+    bool nullable = std::any_of(children.begin(), children.end(),
+        [this, &isOne](NodeId Child) { return !isOne(Child) && Nodes_[Child].Nullable; });
+
+    if (nullable)
+        children.erase(std::remove_if(children.begin(), children.end(), isOne), children.end());
+
+    if (children.size() == 1)
+        return children[0];
+
+    return Intern(Kind::Union, 0, std::move(children));
+}
+
+RegexpAst::NodeId RegexpAst::Kleene(NodeId Source)
+{
+    auto type = Nodes_[Source].Type;
+    if (type == Kind::Kleene || type == Kind::One)
+        return Source;
+
+    //
+    // (1 + r)* -> r*
+    //
+
+    if (type == Kind::Union)
+    {
+        auto children = Nodes_[Source].Children;
+        auto found = std::find_if(children.begin(), children.end(),
+            [this](NodeId Child) { return Nodes_[Child].Type == Kind::One; });
+
+        if (found != children.end())
+        {
+            children.erase(found);
+            auto rest = (children.size() == 1) ? children[0] : Intern(Kind::Union, 0, std::move(children));
+            return Kleene(rest);
+        }
+    }
+
+    return Intern(Kind::Kleene, 0, { Source });
+}
+
+// ******************************************************
+//                        Parsing
+// ******************************************************
+
+//
+// Alternatives of a union are collected as they come and the union is
+// made once, when another operator (or the end) takes it: making every
+// intermediate union of a left-deep chain copies and sorts the
+// alternatives again, which is quadratic in their number
+//
+
+struct ParsedOperand
+{
+    RegexpAst::NodeId Node = 0;
+    std::vector<RegexpAst::NodeId> Alternatives;
+};
+
+RegexpAst::NodeId RegexpAst::Parse(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    if (ReversePolishRegexp.empty())
+        throw std::runtime_error(
+            "Empty regular expression");
+
+    std::stack<ParsedOperand> stack;
+    size_t idx = 0;
+
+    auto node = [](NodeId Node)
+    {
+        ParsedOperand operand;
+        operand.Node = Node;
+        return operand;
+    };
+
+    auto take = [this](ParsedOperand& Operand)
+    {
+        if (Operand.Alternatives.empty())
+            return Operand.Node;
+
+        return Union(std::move(Operand.Alternatives));
+    };
+
+    auto alternatives = [this](ParsedOperand& Operand)
+    {
+        std::vector<NodeId> result = std::move(Operand.Alternatives);
+        if (result.empty())
+            AddAlternatives(Operand.Node, result);
+
+        return result;
+    };
+
+    for (auto sym : ReversePolishRegexp)
+    {
+        if (isspace(sym))
+            continue;
+
+        switch (sym)
+        {
+            case SYM_ONE:
+                stack.push(node(One()));
+                break;
+
+            case SYM_CONCAT:
+            {
+                if (stack.size() < 2)
+                    throw std::runtime_error(
+                        "Not enough operands for concatenation (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                auto second = std::move(stack.top()); stack.pop();
+                auto first = std::move(stack.top());  stack.pop();
+
+                auto firstNode = take(first);
+                stack.push(node(Concat(firstNode, take(second))));
+            }
+                break;
+
+            case SYM_UNION:
+            {
+                if (stack.size() < 2)
+                    throw std::runtime_error(
+                        "Not enough operands for union (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                auto second = std::move(stack.top()); stack.pop();
+                auto first = std::move(stack.top());  stack.pop();
+
+                auto merged = alternatives(first);
+                auto added = alternatives(second);
+                if (merged.size() < added.size())
+                    std::swap(merged, added);
+
+                merged.insert(merged.end(), added.begin(), added.end());
+
+                ParsedOperand operand;
+                operand.Alternatives = std::move(merged);
+                stack.push(std::move(operand));
+            }
+                break;
+
+            case SYM_KLEENE:
+            {
+                if (stack.size() < 1)
+                    throw std::runtime_error(
+                        "No operand for Kleene star (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                auto source = std::move(stack.top()); stack.pop();
+                stack.push(node(Kleene(take(source))));
+            }
+                break;
+
+            default:
+                if (Alphabet.find(sym) == Alphabet.end())
+                    throw std::runtime_error(
+                        "Invalid symbol \'" +
+                        std::string(1, sym) +
+                        "\' (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                stack.push(node(Symbol(sym)));
+        }
+
+        idx++;
+    }
+
+    if (stack.size() != 1)
+        throw std::runtime_error(
+            "Extra expressions left in stack after regular expression parsing (stack.size() = " +
+            std::to_string(stack.size()) + ")");
+
+    return take(stack.top());
+}
+
+// ******************************************************
+//                   Traversals
+// ******************************************************
+
+//
+// Children are interned before their parents, so ids are
+// a topological order
+//
+
+uint64_t RegexpAst::TreeSize(NodeId Root) const
+{
+    std::vector<uint64_t> sizes(Root + 1, 0);
+    for (NodeId id = 0; id <= Root; id++)
+    {
+        uint64_t size = 1;
+        for (auto child : Nodes_[id].Children)
+            size = std::min<uint64_t>(size + sizes[child], UINT64_MAX / 2);
+
+        sizes[id] = size;
+    }
+
+    return sizes[Root];
+}
+
+//
+// Post-order over the tree (a shared node is visited for every use):
+// Leave(Id, Results) gets the results of the children
+//
+
+template <typename Result, typename LeaveFunction>
+Result PostOrder(std::vector<RegexpAst::Node> const& Nodes, RegexpAst::NodeId Root, LeaveFunction Leave)
+{
+    std::vector<std::pair<RegexpAst::NodeId, size_t>> path = { { Root, 0 } };
+    std::vector<Result> results;
+
+    while (!path.empty())
+    {
+        auto& [id, child] = path.back();
+        auto const& children = Nodes[id].Children;
+
+        if (child != children.size())
+        {
+            path.push_back({ children[child++], 0 });
+            continue;
+        }
+
+        auto first = results.end() - std::ptrdiff_t(children.size());
+        auto result = Leave(id, std::vector<Result>(std::make_move_iterator(first), std::make_move_iterator(results.end())));
+        results.erase(first, results.end());
+        results.push_back(std::move(result));
+        path.pop_back();
+    }
+
+    return results.back();
+}
+
+std::string RegexpAst::ToReversePolish(NodeId Root) const
+{
+    return PostOrder<std::string>(Nodes_, Root,
+        [this](NodeId Id, std::vector<std::string> Children)
+        {
+            auto const& node = Nodes_[Id];
+            switch (node.Type)
+            {
+                case Kind::One:    return std::string(1, char(SYM_ONE));
+                case Kind::Symbol: return std::string(1, node.Sym);
+                case Kind::Kleene: return Children[0] + char(SYM_KLEENE);
+                default:           break;
+            }
+
+            auto op = (node.Type == Kind::Concat) ? char(SYM_CONCAT) : char(SYM_UNION);
+            auto text = std::move(Children[0]);
+            for (size_t idx = 1; idx != Children.size(); idx++)
+                text += Children[idx] + op;
+
+            return text;
+        });
+}
+
+bool RegexpAst::LiteralWord(NodeId Id, std::string& Word) const
+{
+    auto const& node = Nodes_[Id];
+    Word.clear();
+
+    switch (node.Type)
+    {
+        case Kind::One:
+            return true;
+
+        case Kind::Symbol:
+            Word = std::string(1, node.Sym);
+            return true;
+
+        case Kind::Concat:
+            for (auto child : node.Children)
+            {
+                if (Nodes_[child].Type != Kind::Symbol)
+                    return false;
+
+                Word += Nodes_[child].Sym;
+            }
+
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+Automaton RegexpAst::Lower(NodeId Root) const
+{
+    //
+    // Children of a literal union are not lowered, the trie is built
+    // from their words
+    //
+
+    auto words = [this](NodeId Id, std::vector<std::string>& Words)
+    {
+        auto const& node = Nodes_[Id];
+        if (node.Type != Kind::Union || node.Children.size() < LiteralUnionMinWords)
+            return false;
+
+        Words.resize(node.Children.size());
+        for (size_t idx = 0; idx != node.Children.size(); idx++)
+            if (!LiteralWord(node.Children[idx], Words[idx]))
+                return false;
+
+        return true;
+    };
+
+    std::vector<Automaton> results;
+    std::vector<std::pair<NodeId, size_t>> path = { { Root, 0 } };
+    std::vector<std::string> trieWords;
+
+    while (!path.empty())
+    {
+        auto& [id, child] = path.back();
+        auto const& node = Nodes_[id];
+
+        if (child == 0 && words(id, trieWords))
+        {
+            results.push_back(CreateTrie(trieWords));
+            path.pop_back();
+            continue;
+        }
+
+        if (child != node.Children.size())
+        {
+            path.push_back({ node.Children[child++], 0 });
+            continue;
+        }
+
+        Automaton lowered = Automaton::Invalid();
+        switch (node.Type)
+        {
+            case Kind::One:
+                lowered = CreateOne();
+                break;
+
+            case Kind::Symbol:
+                lowered = CreateSymbol(node.Sym);
+                break;
+
+            case Kind::Kleene:
+                lowered = CreateKleene(results.back());
+                results.pop_back();
+                break;
+
+            case Kind::Concat:
+            case Kind::Union:
+            {
+                auto first = results.end() - std::ptrdiff_t(node.Children.size());
+                lowered = *first;
+                for (auto operand = first + 1; operand != results.end(); operand++)
+                    lowered = (node.Type == Kind::Concat) ?
+                        CreateConcat(lowered, *operand) :
+                        CreateUnion(lowered, *operand);
+
+                results.erase(first, results.end());
+            }
+                break;
+        }
+
+        results.push_back(lowered);
+        path.pop_back();
+    }
+
+    return results.back();
+}
+
+
+Automaton ParseSimplified(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    RegexpAst ast;
+    auto root = ast.Parse(ReversePolishRegexp, Alphabet);
+    return ast.Lower(root);
+}
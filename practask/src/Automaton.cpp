@@ -27,6 +27,7 @@ Revision History:
 #include <cassert>
 #include <fstream>
 #include <Automaton.h>
+#include <Budget.h>
 
 //
 // Definitions
@@ -63,16 +64,26 @@ bool Transition::operator==(Transition const& Other) const
 
 // -------------------------------------------------------
 
-State::State(size_t Id, std::string Name) :
+//
+// Approximate footprint charged to the Budget:
+// a transition is a node in Outputs_ and a node in Inputs_
+//
+
+size_t const StateBytes = sizeof(State);
+size_t const TransitionBytes = 2 * (sizeof(Transition) + 4 * sizeof(void*));
+
+State::State(size_t Id, char Origin) :
     Id_(Id),
-    Name_(Name)
+    Origin_(Origin)
 {
 }
 
 
-State* State::Allocate(std::string Name)
+State* State::Allocate(char Origin)
 {
-    State* state = new State(TotalAllocated_++, Name);
+    Budget::ChargeBytes(StateBytes);
+
+    State* state = new State(TotalAllocated_++, Origin);
     Allocated_.insert(state);
     return state;
 }
@@ -84,18 +95,58 @@ void State::DestructAll()
         delete state;
     
     Allocated_.clear();
+    Subsets_.clear();
+    TrackProvenance_ = false;
 }
 
 
-void State::ResetAll()
+std::string State::Name() const
+{
+    auto subset = Subsets_.find(this);
+    if (subset == Subsets_.end())
+        return (Origin_ != 0) ? std::string(1, Origin_) : std::string();
+
+    std::string name;
+    for (auto id : subset->second)
+    {
+        if (!name.empty())
+            name += "|";
+
+        name += std::to_string(id);
+    }
+
+    return name;
+}
+
+
+void State::DestructUnreachable(StatesContainer const& Alive)
 {
     for (auto state : Allocated_)
-        state->Color_ = Color::White;
+    {
+        if (Alive.find(state) != Alive.end())
+            continue;
+
+        //
+        // Alive states have no transitions to the unreachable ones,
+        // but may have inputs from them
+        //
+
+        for (auto const& transition : state->Outputs_)
+            if (Alive.find(transition.To) != Alive.end())
+                transition.To->Inputs_.erase(transition);
+
+        Subsets_.erase(state);
+        delete state;
+    }
+
+    Allocated_ = Alive;
 }
 
 
 void State::Connect(State* To, char Sym)
 {
+    Budget::ChargeBytes(TransitionBytes);
+
     Transition transition(/* From = */ this, To, Sym);
     Outputs_.insert(transition);
     To->Inputs_.insert(transition);
@@ -122,6 +173,12 @@ State::TransitionsContainer const& State::Transitions()
 }
 
 
+State::TransitionsContainer const& State::InputTransitions()
+{
+    return Inputs_;
+}
+
+
 State::TransitionsContainer State::TransitionsBy(char Sym)
 {
     TransitionsContainer transitionsBySym;
@@ -145,8 +202,14 @@ State* State::To(char Sym)
     return nullptr;
 }
 
-size_t State::TotalAllocated_ = 0;
-std::set<State*> State::Allocated_;
+//
+// Every thread builds its automatons independently
+//
+
+thread_local size_t State::TotalAllocated_ = 0;
+thread_local std::set<State*> State::Allocated_;
+thread_local bool State::TrackProvenance_ = false;
+thread_local std::unordered_map<State const*, std::vector<size_t>> State::Subsets_;
 
 // -------------------------------------------------------
 
@@ -156,9 +219,10 @@ void Automaton::EndUsing()
 }
 
 
-void DebugAutomatonTraverse(State* State, std::ofstream& DotFile)
+void DebugAutomatonTraverse(State* State, std::ofstream& DotFile, std::vector<::State*>& Visited)
 {
     State->StartVisit();
+    Visited.push_back(State);
 
     if (!State->Finite())
         DotFile << "s" << uint64_t(State) << " [label = \"" << 
@@ -179,7 +243,7 @@ void DebugAutomatonTraverse(State* State, std::ofstream& DotFile)
         if (transition.To->IsVisited())
             continue;
 
-        DebugAutomatonTraverse(transition.To, DotFile);
+        DebugAutomatonTraverse(transition.To, DotFile, Visited);
     }
 
     State->EndVisit();
@@ -195,8 +259,10 @@ void DebugAutomaton(Automaton Debugee, std::string Name, std::string Folder)
     dotFile << "digraph\n{\ndpi = 300;\nrankdir=\"LR\";\n";
     dotFile << "nowhere[label=\"\", shape=\"none\"];";
 
-    DebugAutomatonTraverse(Debugee.Initial, dotFile);
-    State::ResetAll();
+    std::vector<State*> visited;
+    DebugAutomatonTraverse(Debugee.Initial, dotFile, visited);
+    for (auto state : visited)
+        state->ResetVisit();
 
     dotFile << "nowhere->s" << uint64_t(Debugee.Initial) << ";\n";
     dotFile << "}";
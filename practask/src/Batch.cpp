@@ -0,0 +1,100 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Batch.cpp
+
+Abstract:
+
+    Batch mode implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <sstream>
+#include <vector>
+#include <Batch.h>
+#include <Planner.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+//
+// Lines are read in blocks, so that memory does not grow
+// with the input and the output stays in input order
+//
+
+size_t const LinesPerWorker = 256;
+
+std::string SolveQuery(std::string const& Line, AlphabetType const& Alphabet, AutomataCache& Cache, Limits const& QueryLimits)
+{
+    std::istringstream query(Line);
+    std::string regexp, word;
+    query >> regexp >> word;
+
+    try
+    {
+        CheckWord(word, Alphabet);
+
+        Budget budget(QueryLimits);
+        return std::to_string(SolvePlanned(regexp, word, Alphabet, &Cache));
+    }
+
+    catch (const std::exception& e)
+    {
+        return std::string("Error!") + e.what();
+    }
+}
+
+
+void RunBatch(std::istream& Input, std::ostream& Output, AlphabetType const& Alphabet, ThreadPool& Pool, AutomataCache& Cache, Limits const& QueryLimits)
+{
+    auto blockSize = LinesPerWorker * Pool.Size();
+
+    std::vector<std::string> lines;
+    std::vector<std::future<std::string>> answers;
+    lines.reserve(blockSize);
+    answers.reserve(blockSize);
+
+    bool eof = false;
+    while (!eof)
+    {
+        lines.clear();
+        answers.clear();
+
+        std::string line;
+        while (lines.size() != blockSize)
+        {
+            if (!std::getline(Input, line))
+            {
+                eof = true;
+                break;
+            }
+
+            lines.push_back(std::move(line));
+        }
+
+        for (auto const& query : lines)
+            answers.push_back(Pool.Submit(
+                [&query, &Alphabet, &Cache, &QueryLimits]() { return SolveQuery(query, Alphabet, Cache, QueryLimits); }));
+
+        for (auto& answer : answers)
+            Output << answer.get() << "\n";
+    }
+
+    Output.flush();
+}
@@ -0,0 +1,345 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    BottomUp.cpp
+
+Abstract:
+
+    Bottom-up compilation implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <stack>
+#include <stdexcept>
+#include <vector>
+#include <BottomUp.h>
+#include <Budget.h>
+#include <Regexp.h>
+
+//
+// Definitions
+//
+
+using StateId = CompiledAutomaton::StateId;
+
+//
+// Tuple of the operand states standing for a state of the result,
+// empty one is Dead
+//
+
+using StateKey = std::vector<StateId>;
+
+//
+// Breadth-first over the keys reachable from Initial. Step(Key, Sym)
+// gives the key of the target, Finite(Key) tells if it accepts.
+//
+
+template <typename StepFunction, typename FiniteFunction>
+std::optional<CompiledAutomaton> BuildFromKeys
+(
+    std::string const& Symbols,
+    StateKey Initial,
+    StepFunction Step,
+    FiniteFunction Finite,
+    size_t MaxStates
+)
+{
+    std::map<StateKey, StateId> ids;
+    std::queue<StateKey const*> bfsQueue;
+
+    std::vector<StateId> table;
+    std::vector<uint8_t> finite;
+
+    auto intern = [&](StateKey Key) -> std::optional<StateId>
+    {
+        auto found = ids.find(Key);
+        if (found != ids.end())
+            return found->second;
+
+        if (ids.size() >= MaxStates)
+            return std::nullopt;
+
+        auto inserted = ids.emplace(std::move(Key), StateId(ids.size())).first;
+        finite.push_back(Finite(inserted->first));
+        table.resize(table.size() + Symbols.size(), CompiledAutomaton::Dead);
+        bfsQueue.push(&inserted->first);
+        return inserted->second;
+    };
+
+    intern(std::move(Initial));
+
+    while (!bfsQueue.empty())
+    {
+        auto const& key = *bfsQueue.front();
+        bfsQueue.pop();
+
+        auto from = ids.at(key);
+        Budget::Tick(key.size() * Symbols.size());
+
+        for (size_t column = 0; column != Symbols.size(); column++)
+        {
+            auto to = Step(key, Symbols[column]);
+            if (to.empty())
+                continue;
+
+            auto id = intern(std::move(to));
+            if (!id)
+                return std::nullopt;
+
+            table[from * Symbols.size() + column] = *id;
+        }
+    }
+
+    return CompiledAutomaton::FromTable(Symbols, std::move(table), std::move(finite));
+}
+
+void Normalize(StateKey& Key)
+{
+    std::sort(Key.begin(), Key.end());
+    Key.erase(std::unique(Key.begin(), Key.end()), Key.end());
+}
+
+// ******************************************************
+//                      Operators
+// ******************************************************
+
+std::optional<CompiledAutomaton> DfsmUnion(CompiledAutomaton const& First, CompiledAutomaton const& Second, size_t MaxStates)
+{
+    //
+    // (first, second), either may be Dead
+    //
+
+    auto dead = CompiledAutomaton::Dead;
+
+    return BuildFromKeys(First.Symbols(), { First.Initial(), Second.Initial() },
+        [&](StateKey const& Key, char Sym)
+        {
+            StateKey to = {
+                (Key[0] == dead) ? dead : First.Step(Key[0], Sym),
+                (Key[1] == dead) ? dead : Second.Step(Key[1], Sym) };
+
+            return (to[0] == dead && to[1] == dead) ? StateKey() : to;
+        },
+        [&](StateKey const& Key)
+        {
+            return (Key[0] != dead && First.Finite(Key[0])) ||
+                   (Key[1] != dead && Second.Finite(Key[1]));
+        },
+        MaxStates);
+}
+
+std::optional<CompiledAutomaton> DfsmConcat(CompiledAutomaton const& First, CompiledAutomaton const& Second, size_t MaxStates)
+{
+    //
+    // (first, sorted subset of second), first may be Dead. Second
+    // starts over every time first accepts.
+    //
+
+    auto dead = CompiledAutomaton::Dead;
+
+    auto close = [&](StateKey Key)
+    {
+        if (Key[0] != dead && First.Finite(Key[0]))
+            Key.push_back(Second.Initial());
+
+        std::sort(Key.begin() + 1, Key.end());
+        Key.erase(std::unique(Key.begin() + 1, Key.end()), Key.end());
+        return Key;
+    };
+
+    return BuildFromKeys(First.Symbols(), close({ First.Initial() }),
+        [&](StateKey const& Key, char Sym)
+        {
+            StateKey to = { (Key[0] == dead) ? dead : First.Step(Key[0], Sym) };
+            for (size_t idx = 1; idx != Key.size(); idx++)
+            {
+                auto next = Second.Step(Key[idx], Sym);
+                if (next != dead)
+                    to.push_back(next);
+            }
+
+            to = close(std::move(to));
+            return (to.size() == 1 && to[0] == dead) ? StateKey() : to;
+        },
+        [&](StateKey const& Key)
+        {
+            for (size_t idx = 1; idx != Key.size(); idx++)
+                if (Second.Finite(Key[idx]))
+                    return true;
+
+            return false;
+        },
+        MaxStates);
+}
+
+std::optional<CompiledAutomaton> DfsmKleene(CompiledAutomaton const& Source, size_t MaxStates)
+{
+    //
+    // Sorted subsets of source; the initial state accepts the empty word,
+    // so it is marked with Dead, which no subset contains
+    //
+
+    auto dead = CompiledAutomaton::Dead;
+
+    auto accepts = [&](StateKey const& Key)
+    {
+        for (auto state : Key)
+            if (state != dead && Source.Finite(state))
+                return true;
+
+        return false;
+    };
+
+    return BuildFromKeys(Source.Symbols(), { dead },
+        [&](StateKey const& Key, char Sym)
+        {
+            StateKey to;
+            for (auto state : Key)
+            {
+                auto next = Source.Step((state == dead) ? Source.Initial() : state, Sym);
+                if (next != dead)
+                    to.push_back(next);
+            }
+
+            if (accepts(to))
+                to.push_back(Source.Initial());
+
+            Normalize(to);
+            return to;
+        },
+        [&](StateKey const& Key)
+        {
+            return (Key.size() == 1 && Key[0] == dead) || accepts(Key);
+        },
+        MaxStates);
+}
+
+// ******************************************************
+//                     Compilation
+// ******************************************************
+
+CompiledAutomaton MinimizeOperand(CompiledAutomaton const& Automaton)
+{
+    return Minimize(TrimDeadStates(Automaton));
+}
+
+CompiledAutomaton CompileRegexpBottomUp(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet, size_t MaxStates, BottomUpStats* Stats)
+{
+    BottomUpStats stats;
+    auto& current = (Stats != nullptr) ? *Stats : stats;
+    current = BottomUpStats();
+
+    if (ReversePolishRegexp.empty())
+        throw std::runtime_error(
+            "Empty regular expression");
+
+    std::string symbols(Alphabet.begin(), Alphabet.end());
+    std::stack<CompiledAutomaton> stack;
+    size_t idx = 0;
+
+    auto push = [&](std::optional<CompiledAutomaton> Result)
+    {
+        if (!Result)
+            return false;
+
+        current.PeakStates = std::max(current.PeakStates, Result->StatesCount());
+        stack.push(MinimizeOperand(*Result));
+        return true;
+    };
+
+    for (auto sym : ReversePolishRegexp)
+    {
+        if (isspace(sym))
+            continue;
+
+        bool fits = true;
+        switch (sym)
+        {
+            case SYM_ONE:
+                push(CompiledAutomaton::FromTable(symbols,
+                    std::vector<StateId>(symbols.size(), CompiledAutomaton::Dead), { 1 }));
+                break;
+
+            case SYM_CONCAT:
+            case SYM_UNION:
+            {
+                if (stack.size() < 2)
+                    throw std::runtime_error(
+                        std::string((sym == SYM_CONCAT) ?
+                            "Not enough operands for concatenation (regexp_idx = " :
+                            "Not enough operands for union (regexp_idx = ") +
+                        std::to_string(idx) + ")");
+
+                auto second = stack.top(); stack.pop();
+                auto first = stack.top();  stack.pop();
+                fits = push((sym == SYM_CONCAT) ?
+                    DfsmConcat(first, second, MaxStates) :
+                    DfsmUnion(first, second, MaxStates));
+            }
+                break;
+
+            case SYM_KLEENE:
+            {
+                if (stack.size() < 1)
+                    throw std::runtime_error(
+                        "No operand for Kleene star (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                auto source = stack.top(); stack.pop();
+                fits = push(DfsmKleene(source, MaxStates));
+            }
+                break;
+
+            default:
+            {
+                if (Alphabet.find(sym) == Alphabet.end())
+                    throw std::runtime_error(
+                        "Invalid symbol \'" +
+                        std::string(1, sym) +
+                        "\' (regexp_idx = " +
+                        std::to_string(idx) + ")");
+
+                std::vector<StateId> table(2 * symbols.size(), CompiledAutomaton::Dead);
+                table[symbols.find(sym)] = 1;
+                push(CompiledAutomaton::FromTable(symbols, std::move(table), { 0, 1 }));
+            }
+        }
+
+        //
+        // Too big to combine bottom-up: the NDFSM of the whole regexp
+        // is determinized at once
+        //
+
+        if (!fits)
+        {
+            current.FellBack = true;
+            return CompileRegexp(ReversePolishRegexp, Alphabet);
+        }
+
+        idx++;
+    }
+
+    if (stack.size() != 1)
+        throw std::runtime_error(
+            "Extra expressions left in stack after regular expression parsing (stack.size() = " +
+            std::to_string(stack.size()) + ")");
+
+    return stack.top();
+}
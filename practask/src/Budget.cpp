@@ -0,0 +1,112 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Budget.cpp
+
+Abstract:
+
+    Resource limits implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Budget.h>
+
+//
+// Definitions
+//
+
+char const* ResourceMessage(BudgetExceeded::Resource Exhausted)
+{
+    switch (Exhausted)
+    {
+        case BudgetExceeded::Resource::DfsmStates: return "Budget exceeded: DFSM states limit";
+        case BudgetExceeded::Resource::Bytes:      return "Budget exceeded: memory limit";
+        case BudgetExceeded::Resource::Deadline:   return "Budget exceeded: deadline";
+    }
+
+    return "Budget exceeded";
+}
+
+
+BudgetExceeded::BudgetExceeded(Resource Exhausted) :
+    std::runtime_error(ResourceMessage(Exhausted)),
+    Resource_(Exhausted)
+{
+}
+
+// -------------------------------------------------------
+
+thread_local Budget* Budget::Current_ = nullptr;
+
+Budget::Budget(Limits const& Limits) :
+    Previous_(Current_),
+    Limits_(Limits),
+    Deadline_(std::chrono::steady_clock::now() + Limits.Timeout)
+{
+    Current_ = this;
+}
+
+
+Budget::~Budget()
+{
+    Current_ = Previous_;
+}
+
+
+void Budget::ResetUsage()
+{
+    DfsmStates_ = 0;
+    Bytes_ = 0;
+}
+
+
+void Budget::CheckDeadline()
+{
+    Work_ = 0;
+
+    if (Limits_.Timeout.count() != 0 && std::chrono::steady_clock::now() > Deadline_)
+        throw BudgetExceeded(BudgetExceeded::Resource::Deadline);
+}
+
+
+void Budget::ChargeDfsmState()
+{
+    auto budget = Current_;
+    if (budget == nullptr)
+        return;
+
+    auto limit = budget->Limits_.MaxDfsmStates;
+    if (limit != 0 && ++budget->DfsmStates_ > limit)
+        throw BudgetExceeded(BudgetExceeded::Resource::DfsmStates);
+
+    Tick();
+}
+
+
+void Budget::ChargeBytes(size_t Bytes)
+{
+    auto budget = Current_;
+    if (budget == nullptr)
+        return;
+
+    auto limit = budget->Limits_.MaxBytes;
+    budget->Bytes_ += Bytes;
+    if (limit != 0 && budget->Bytes_ > limit)
+        throw BudgetExceeded(BudgetExceeded::Resource::Bytes);
+
+    Tick();
+}
@@ -0,0 +1,141 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    CApi.cpp
+
+Abstract:
+
+    C API of libregsolver implementation. No exception crosses it.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <regsolver.h>
+#include <Session.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+struct regsolver_regexp
+{
+    CompiledAutomaton Automaton;
+};
+
+
+char* CopyError(char const* What)
+{
+    auto error = static_cast<char*>(malloc(strlen(What) + 1));
+    if (error != nullptr)
+        strcpy(error, What);
+
+    return error;
+}
+
+
+regsolver_regexp* regsolver_compile(char const* Regexp, size_t RegexpLength, char const* Alphabet, size_t AlphabetLength, char** Error)
+{
+    if (Error != nullptr)
+        *Error = nullptr;
+
+    try
+    {
+        AlphabetType alphabet(Alphabet, Alphabet + AlphabetLength);
+        auto automaton = CompileRegexp(std::string(Regexp, RegexpLength), alphabet);
+        return new regsolver_regexp{ std::move(automaton) };
+    }
+
+    catch (const std::exception& e)
+    {
+        if (Error != nullptr)
+            *Error = CopyError(e.what());
+    }
+
+    catch (...)
+    {
+        if (Error != nullptr)
+            *Error = CopyError("Unknown error");
+    }
+
+    return nullptr;
+}
+
+
+size_t regsolver_match(regsolver_regexp const* Handle, char const* Word, size_t WordLength)
+{
+    try
+    {
+        return SolveTask13(Handle->Automaton, std::string_view(Word, WordLength));
+    }
+
+    catch (...)
+    {
+        return REGSOLVER_MATCH_FAILED;
+    }
+}
+
+
+int regsolver_find(regsolver_regexp const* Handle, char const* Word, size_t WordLength, size_t* Begin, size_t* End)
+{
+    try
+    {
+        auto longest = FindLongestMatch(Handle->Automaton, std::string_view(Word, WordLength));
+        if (!longest)
+            return 0;
+
+        *Begin = longest->Begin;
+        *End = longest->End;
+        return 1;
+    }
+
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+
+int regsolver_scan(regsolver_regexp const* Handle, char const* Word, size_t WordLength, regsolver_end_callback OnEnd, void* Context)
+{
+    try
+    {
+        MatchSession session(Handle->Automaton);
+        session.Append(std::string_view(Word, WordLength),
+            [OnEnd, Context](size_t Begin, size_t End) { OnEnd(Context, Begin, End); });
+
+        return 0;
+    }
+
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+
+void regsolver_free(regsolver_regexp* Handle)
+{
+    delete Handle;
+}
+
+
+void regsolver_free_error(char* Error)
+{
+    free(Error);
+}
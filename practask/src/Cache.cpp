@@ -0,0 +1,203 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Cache.cpp
+
+Abstract:
+
+    Compiled automatons cache implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <Budget.h>
+#include <Cache.h>
+
+//
+// Definitions
+//
+
+std::string CacheKey(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    std::string key(Alphabet.begin(), Alphabet.end());
+    std::sort(key.begin(), key.end());
+
+    key += '\0';
+    key += ReversePolishRegexp;
+    return key;
+}
+
+
+AutomataCache::AutomataCache(size_t Capacity) :
+    Capacity_(Capacity)
+{
+}
+
+
+template <typename Compiled, typename Compiler>
+std::shared_ptr<Compiled const> AutomataCache::Lookup(EntriesType<Compiled>& Entries, std::string const& Key, Compiler const& Compile)
+{
+    using PointerType = std::shared_ptr<Compiled const>;
+
+    for (;;)
+    {
+        std::promise<PointerType> promise;
+        std::shared_future<PointerType> future;
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            auto entryIt = Entries.Map.find(Key);
+
+            if (entryIt != Entries.Map.end())
+            {
+                Hits_++;
+                future = entryIt->second.first;
+                Entries.Order.splice(Entries.Order.begin(), Entries.Order, entryIt->second.second);
+            }
+
+            else
+            {
+                Misses_++;
+                Entries.Order.push_front(Key);
+                Entries.Map.emplace(Key, std::make_pair(promise.get_future().share(), Entries.Order.begin()));
+
+                //
+                // Evicted compilation still completes for its waiters
+                //
+
+                if (Capacity_ != 0 && Entries.Map.size() > Capacity_)
+                {
+                    Entries.Map.erase(Entries.Order.back());
+                    Entries.Order.pop_back();
+                }
+            }
+        }
+
+        //
+        // Someone else compiles (or has compiled) this key. The wait is
+        // bounded by the deadline of this query, not of the compiling one
+        //
+
+        if (future.valid())
+        {
+            auto budget = Budget::Current();
+            auto deadline = budget ? budget->Deadline() : std::chrono::steady_clock::time_point::max();
+
+            if (deadline != std::chrono::steady_clock::time_point::max() &&
+                future.wait_until(deadline) == std::future_status::timeout)
+                throw BudgetExceeded(BudgetExceeded::Resource::Deadline);
+
+            auto compiled = future.get();
+            if (compiled)
+                return compiled;
+
+            //
+            // Compilation failed for reasons of its caller (nullptr),
+            // the entry is already gone, so compile under own budget
+            //
+
+            continue;
+        }
+
+        auto forget = [this, &Entries, &Key]()
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            auto entryIt = Entries.Map.find(Key);
+            if (entryIt == Entries.Map.end())
+                return;
+
+            Entries.Order.erase(entryIt->second.second);
+            Entries.Map.erase(entryIt);
+        };
+
+        try
+        {
+            auto compiled = std::make_shared<Compiled const>(Compile());
+
+            promise.set_value(compiled);
+            return compiled;
+        }
+
+        catch (BudgetExceeded const&)
+        {
+            //
+            // Limits differ between callers, so the failure is neither
+            // cached nor passed to the waiters
+            //
+
+            forget();
+            promise.set_value(nullptr);
+            throw;
+        }
+
+        catch (std::runtime_error const&)
+        {
+            //
+            // Malformed regexp stays malformed
+            //
+
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        catch (...)
+        {
+            forget();
+            promise.set_value(nullptr);
+            throw;
+        }
+    }
+}
+
+
+AutomataCache::Pointer AutomataCache::Get(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    return Lookup(Entries_, CacheKey(ReversePolishRegexp, Alphabet),
+        [&]() { return CompileRegexp(ReversePolishRegexp, Alphabet); });
+}
+
+
+AutomataCache::NfaPointer AutomataCache::GetNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    return Lookup(NfaEntries_, CacheKey(ReversePolishRegexp, Alphabet),
+        [&]() { return CompileNfa(ReversePolishRegexp, Alphabet); });
+}
+
+
+bool AutomataCache::Contains(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    auto key = CacheKey(ReversePolishRegexp, Alphabet);
+
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Entries_.Map.find(key) != Entries_.Map.end();
+}
+
+
+bool AutomataCache::ContainsNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    auto key = CacheKey(ReversePolishRegexp, Alphabet);
+
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return NfaEntries_.Map.find(key) != NfaEntries_.Map.end();
+}
+
+
+size_t AutomataCache::Size()
+{
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Entries_.Map.size() + NfaEntries_.Map.size();
+}
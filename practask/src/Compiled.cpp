@@ -0,0 +1,561 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Compiled.cpp
+
+Abstract:
+
+    Compiled automaton construction.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <map>
+#include <stack>
+#include <Ast.h>
+#include <Compiled.h>
+#include <Regexp.h>
+#include <Optimize.h>
+
+//
+// Definitions
+//
+
+CompiledAutomaton::CompiledAutomaton()
+{
+    Columns_.fill(-1);
+}
+
+
+std::vector<State*> CollectReachable(State* Initial)
+{
+    std::vector<State*> reachable;
+    std::stack<State*> dfsStack;
+
+    Initial->StartVisit();
+    dfsStack.push(Initial);
+
+    while (!dfsStack.empty())
+    {
+        auto state = dfsStack.top();
+        dfsStack.pop();
+        reachable.push_back(state);
+
+        for (auto const& transition : state->Transitions())
+        {
+            if (transition.To->IsVisited())
+                continue;
+
+            transition.To->StartVisit();
+            dfsStack.push(transition.To);
+        }
+    }
+
+    for (auto state : reachable)
+        state->ResetVisit();
+
+    return reachable;
+}
+
+
+CompiledAutomaton CompiledAutomaton::FromDfsm(Automaton Dfsm, AlphabetType const& Alphabet)
+{
+    assert(Dfsm.IsValid());
+
+    CompiledAutomaton compiled;
+    compiled.Symbols_.assign(Alphabet.begin(), Alphabet.end());
+    std::sort(compiled.Symbols_.begin(), compiled.Symbols_.end());
+
+    for (size_t column = 0; column != compiled.Symbols_.size(); column++)
+        compiled.Columns_[uint8_t(compiled.Symbols_[column])] = int16_t(column);
+
+    auto states = CollectReachable(Dfsm.Initial);
+    std::sort(states.begin(), states.end(),
+        [&Dfsm](State* First, State* Second)
+        {
+            if (First == Dfsm.Initial || Second == Dfsm.Initial)
+                return First == Dfsm.Initial && Second != Dfsm.Initial;
+
+            return First->Id() < Second->Id();
+        });
+
+    std::map<State*, StateId> ids;
+    for (auto state : states)
+        ids.emplace(state, StateId(ids.size()));
+
+    auto alphabetSize = compiled.Symbols_.size();
+    compiled.Table_.assign(states.size() * alphabetSize, Dead);
+    compiled.Finite_.assign(states.size(), 0);
+
+    for (auto state : states)
+    {
+        auto id = ids.at(state);
+        compiled.Finite_[id] = state->Finite();
+
+        for (size_t column = 0; column != alphabetSize; column++)
+        {
+            auto to = state->To(compiled.Symbols_[column]);
+            if (to != nullptr)
+                compiled.Table_[id * alphabetSize + column] = ids.at(to);
+        }
+    }
+
+    compiled.PickWidth();
+    compiled.Analyze();
+    return compiled;
+}
+
+
+CompiledAutomaton CompiledAutomaton::FromTable(std::string Symbols, std::vector<StateId> Table, std::vector<uint8_t> Finite)
+{
+    assert(Table.size() == Symbols.size() * Finite.size());
+
+    CompiledAutomaton compiled;
+    compiled.Symbols_ = std::move(Symbols);
+    compiled.Table_ = std::move(Table);
+    compiled.Finite_ = std::move(Finite);
+
+    for (size_t column = 0; column != compiled.Symbols_.size(); column++)
+        compiled.Columns_[uint8_t(compiled.Symbols_[column])] = int16_t(column);
+
+    compiled.PickWidth();
+    compiled.Analyze();
+    return compiled;
+}
+
+
+void CompiledAutomaton::PickWidth()
+{
+    if (StatesCount() >= NarrowDead)
+        return;
+
+    NarrowTable_.resize(Table_.size());
+    for (size_t idx = 0; idx != Table_.size(); idx++)
+        NarrowTable_[idx] = (Table_[idx] == Dead) ? NarrowDead : NarrowId(Table_[idx]);
+
+    Narrow_ = true;
+    Table_ = std::vector<StateId>();
+}
+
+
+std::vector<uint8_t> CoReachableStates(CompiledAutomaton const& Automaton)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    auto statesCount = Automaton.StatesCount();
+    std::vector<std::vector<StateId>> inputs(statesCount);
+    std::vector<StateId> bfsQueue;
+    std::vector<uint8_t> coReachable(statesCount, 0);
+
+    for (StateId state = 0; state != statesCount; state++)
+    {
+        for (auto sym : Automaton.Symbols())
+        {
+            auto to = Automaton.Step(state, sym);
+            if (to != CompiledAutomaton::Dead)
+                inputs[to].push_back(state);
+        }
+
+        if (Automaton.Finite(state))
+        {
+            coReachable[state] = 1;
+            bfsQueue.push_back(state);
+        }
+    }
+
+    for (size_t idx = 0; idx != bfsQueue.size(); idx++)
+    {
+        for (auto from : inputs[bfsQueue[idx]])
+        {
+            if (coReachable[from])
+                continue;
+
+            coReachable[from] = 1;
+            bfsQueue.push_back(from);
+        }
+    }
+
+    return coReachable;
+}
+
+
+void CompiledAutomaton::AnalyzeLengths()
+{
+    //
+    // Shortest: BFS from the initial state
+    //
+
+    std::vector<size_t> distance(StatesCount(), Unbounded);
+    std::vector<StateId> bfsQueue = {Initial()};
+    distance[Initial()] = 0;
+    MinLength_ = Unbounded;
+
+    for (size_t idx = 0; idx != bfsQueue.size(); idx++)
+    {
+        auto state = bfsQueue[idx];
+        if (Finite(state))
+            MinLength_ = std::min(MinLength_, distance[state]);
+
+        for (auto sym : Symbols_)
+        {
+            auto to = Step(state, sym);
+            if (to == Dead || distance[to] != Unbounded)
+                continue;
+
+            distance[to] = distance[state] + 1;
+            bfsQueue.push_back(to);
+        }
+    }
+
+    //
+    // Longest: longest path in the useful part, unbounded on a cycle
+    //
+
+    MaxLength_ = 0;
+    auto useful = CoReachableStates(*this);
+    if (!useful[Initial()])
+        return;
+
+    enum : uint8_t { White, Gray, Black };
+    std::vector<uint8_t> color(StatesCount(), White);
+    std::vector<size_t> longest(StatesCount(), 0);
+    std::vector<std::pair<StateId, size_t>> dfsStack = {{Initial(), 0}};
+    color[Initial()] = Gray;
+
+    while (!dfsStack.empty())
+    {
+        auto state = dfsStack.back().first;
+        auto column = dfsStack.back().second++;
+
+        if (column == Symbols_.size())
+        {
+            for (auto sym : Symbols_)
+            {
+                auto to = Step(state, sym);
+                if (to != Dead && useful[to])
+                    longest[state] = std::max(longest[state], longest[to] + 1);
+            }
+
+            color[state] = Black;
+            dfsStack.pop_back();
+            continue;
+        }
+
+        auto to = Step(state, Symbols_[column]);
+        if (to == Dead || !useful[to] || color[to] == Black)
+            continue;
+
+        if (color[to] == Gray)
+        {
+            MaxLength_ = Unbounded;
+            return;
+        }
+
+        color[to] = Gray;
+        dfsStack.push_back({to, 0});
+    }
+
+    MaxLength_ = longest[Initial()];
+}
+
+
+void CompiledAutomaton::Analyze()
+{
+    AnalyzeLengths();
+
+    std::string firstSymbols;
+    for (auto sym : Symbols_)
+        if (Step(Initial(), sym) != Dead)
+            firstSymbols += sym;
+
+    FirstSymbols_ = ByteScanner(firstSymbols);
+
+    //
+    // Follow the only transition while it is the only way to accept
+    //
+
+    RequiredPrefix_.clear();
+    auto current = Initial();
+
+    while (!Finite(current) && RequiredPrefix_.length() < StatesCount())
+    {
+        StateId next = Dead;
+        char nextSym = '\0';
+        size_t transitions = 0;
+
+        for (auto sym : Symbols_)
+        {
+            auto to = Step(current, sym);
+            if (to == Dead)
+                continue;
+
+            next = to;
+            nextSym = sym;
+            transitions++;
+        }
+
+        if (transitions != 1)
+            break;
+
+        RequiredPrefix_ += nextSym;
+        current = next;
+    }
+}
+
+
+CompiledAutomaton TrimDeadStates(CompiledAutomaton const& Automaton)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    auto statesCount = Automaton.StatesCount();
+    auto const& symbols = Automaton.Symbols();
+    auto useful = CoReachableStates(Automaton);
+
+    //
+    // Initial state is kept even if useless (empty language)
+    //
+
+    useful[Automaton.Initial()] = 1;
+
+    std::vector<StateId> ids(statesCount, CompiledAutomaton::Dead);
+    StateId usefulCount = 0;
+    for (StateId state = 0; state != statesCount; state++)
+        if (useful[state])
+            ids[state] = usefulCount++;
+
+    std::vector<StateId> table(usefulCount * symbols.size(), CompiledAutomaton::Dead);
+    std::vector<uint8_t> finite(usefulCount, 0);
+
+    for (StateId state = 0; state != statesCount; state++)
+    {
+        if (!useful[state])
+            continue;
+
+        finite[ids[state]] = Automaton.Finite(state);
+        for (size_t column = 0; column != symbols.size(); column++)
+        {
+            auto to = Automaton.Step(state, symbols[column]);
+            if (to != CompiledAutomaton::Dead)
+                table[ids[state] * symbols.size() + column] = ids[to];
+        }
+    }
+
+    return CompiledAutomaton::FromTable(symbols, std::move(table), std::move(finite));
+}
+
+
+CompiledAutomaton Minimize(CompiledAutomaton const& Automaton)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    auto statesCount = Automaton.StatesCount();
+    auto const& symbols = Automaton.Symbols();
+
+    //
+    // Dead transitions get class statesCount, which no state has
+    //
+
+    std::vector<StateId> classOf(statesCount);
+    for (StateId state = 0; state != statesCount; state++)
+        classOf[state] = Automaton.Finite(state);
+
+    size_t classesCount = 0;
+    while (true)
+    {
+        std::map<std::vector<StateId>, StateId> classes;
+        std::vector<StateId> newClassOf(statesCount);
+
+        for (StateId state = 0; state != statesCount; state++)
+        {
+            std::vector<StateId> signature(1, classOf[state]);
+            for (auto sym : symbols)
+            {
+                auto to = Automaton.Step(state, sym);
+                signature.push_back(to == CompiledAutomaton::Dead ? StateId(statesCount) : classOf[to]);
+            }
+
+            auto inserted = classes.emplace(std::move(signature), StateId(classes.size()));
+            newClassOf[state] = inserted.first->second;
+        }
+
+        classOf.swap(newClassOf);
+        if (classes.size() == classesCount)
+            break;
+
+        classesCount = classes.size();
+    }
+
+    //
+    // State 0 is the first one numbered, so the initial class stays 0
+    //
+
+    std::vector<StateId> table(classesCount * symbols.size(), CompiledAutomaton::Dead);
+    std::vector<uint8_t> finite(classesCount, 0);
+
+    for (StateId state = 0; state != statesCount; state++)
+    {
+        auto minimized = classOf[state];
+        finite[minimized] = Automaton.Finite(state);
+
+        for (size_t column = 0; column != symbols.size(); column++)
+        {
+            auto to = Automaton.Step(state, symbols[column]);
+            if (to != CompiledAutomaton::Dead)
+                table[minimized * symbols.size() + column] = classOf[to];
+        }
+    }
+
+    return CompiledAutomaton::FromTable(symbols, std::move(table), std::move(finite));
+}
+
+
+CompiledAutomaton Renumber(CompiledAutomaton const& Automaton, std::vector<CompiledAutomaton::StateId> const& Order)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    auto statesCount = Automaton.StatesCount();
+    auto const& symbols = Automaton.Symbols();
+    assert(Order.size() == statesCount && Order[0] == Automaton.Initial());
+
+    std::vector<StateId> ids(statesCount, CompiledAutomaton::Dead);
+    for (StateId id = 0; id != statesCount; id++)
+        ids[Order[id]] = id;
+
+    std::vector<StateId> table;
+    std::vector<uint8_t> finite;
+    table.reserve(statesCount * symbols.size());
+    finite.reserve(statesCount);
+
+    for (auto state : Order)
+    {
+        finite.push_back(Automaton.Finite(state));
+        for (auto sym : symbols)
+        {
+            auto to = Automaton.Step(state, sym);
+            table.push_back(to == CompiledAutomaton::Dead ? to : ids[to]);
+        }
+    }
+
+    return CompiledAutomaton::FromTable(symbols, std::move(table), std::move(finite));
+}
+
+
+std::vector<CompiledAutomaton::StateId> BreadthFirstOrder(CompiledAutomaton const& Automaton)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    auto statesCount = Automaton.StatesCount();
+    std::vector<StateId> order = {Automaton.Initial()};
+    std::vector<uint8_t> seen(statesCount, 0);
+    seen[Automaton.Initial()] = 1;
+
+    for (size_t current = 0; current != order.size(); current++)
+    {
+        for (auto sym : Automaton.Symbols())
+        {
+            auto to = Automaton.Step(order[current], sym);
+            if (to != CompiledAutomaton::Dead && !seen[to])
+            {
+                seen[to] = 1;
+                order.push_back(to);
+            }
+        }
+    }
+
+    //
+    // Unreachable ones keep their relative order at the end
+    //
+
+    for (StateId state = 0; state != statesCount; state++)
+        if (!seen[state])
+            order.push_back(state);
+
+    return order;
+}
+
+
+CompiledAutomaton RenumberBreadthFirst(CompiledAutomaton const& Automaton)
+{
+    return Renumber(Automaton, BreadthFirstOrder(Automaton));
+}
+
+
+std::vector<uint64_t> CountVisits(CompiledAutomaton const& Automaton, std::vector<std::string_view> const& Samples)
+{
+    std::vector<uint64_t> visits(Automaton.StatesCount(), 0);
+    auto maxLength = Automaton.MaxLength();
+
+    for (auto sample : Samples)
+    {
+        for (size_t begin = 0; begin != sample.length(); begin++)
+        {
+            auto state = Automaton.Initial();
+            visits[state]++;
+
+            auto end = begin + std::min(sample.length() - begin, maxLength);
+            for (auto position = begin; position != end; position++)
+            {
+                state = Automaton.Step(state, sample[position]);
+                if (state == CompiledAutomaton::Dead)
+                    break;
+
+                visits[state]++;
+            }
+        }
+    }
+
+    return visits;
+}
+
+
+CompiledAutomaton RenumberByVisits(CompiledAutomaton const& Automaton, std::vector<uint64_t> const& Visits)
+{
+    assert(Visits.size() == Automaton.StatesCount());
+
+    auto order = BreadthFirstOrder(Automaton);
+    std::stable_sort(order.begin() + 1, order.end(),
+        [&Visits](CompiledAutomaton::StateId First, CompiledAutomaton::StateId Second)
+        {
+            return Visits[First] > Visits[Second];
+        });
+
+    return Renumber(Automaton, order);
+}
+
+
+CompiledAutomaton CompileRegexp(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    Automaton::StartUsing();
+
+    try
+    {
+        auto automaton = ParseSimplified(ReversePolishRegexp, Alphabet);
+        automaton = ThompsonToDfsm(automaton, Alphabet);
+        automaton = CompactStates(automaton);
+        automaton = RemoveUselessStates(automaton);
+
+        auto compiled = CompiledAutomaton::FromDfsm(automaton, Alphabet);
+        Automaton::EndUsing();
+        return compiled;
+    }
+
+    catch (...)
+    {
+        Automaton::EndUsing();
+        throw;
+    }
+}
@@ -0,0 +1,451 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Determinize.cpp
+
+Abstract:
+
+    Parallel subset construction implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <Budget.h>
+#include <Determinize.h>
+
+//
+// Definitions
+//
+
+using Subset = std::vector<CompiledNfa::StateId>;
+using DfsmState = CompiledAutomaton::StateId;
+
+struct SubsetHash
+{
+    size_t operator()(Subset const& Set) const
+    {
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ Set.size();
+        for (auto state : Set)
+        {
+            hash ^= state + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+            hash *= 0xFF51AFD7ED558CCDull;
+        }
+
+        return size_t(hash ^ (hash >> 32));
+    }
+};
+
+// ******************************************************
+//                   Interning table
+// ******************************************************
+
+//
+// Sharded by hash, each shard under its own mutex, so workers meet
+// only when they hit the same shard
+//
+
+class InterningTable
+{
+protected:
+    static size_t const ShardsCount = 64;
+
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::unordered_map<Subset, DfsmState, SubsetHash> Ids;
+    };
+
+    std::unique_ptr<Shard[]> Shards_;
+    std::atomic<DfsmState> Next_{0};
+
+public:
+    InterningTable() :
+        Shards_(new Shard[ShardsCount])
+    {
+    }
+
+    //
+    // Id of the set, inserted -- it is new (and the caller must expand it)
+    //
+
+    DfsmState Intern(Subset const& Set, bool& Inserted)
+    {
+        auto hash = SubsetHash()(Set);
+        auto& shard = Shards_[(hash >> 7) % ShardsCount];
+
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        auto found = shard.Ids.find(Set);
+        Inserted = (found == shard.Ids.end());
+
+        if (!Inserted)
+            return found->second;
+
+        auto id = Next_.fetch_add(1, std::memory_order_relaxed);
+        shard.Ids.emplace(Set, id);
+        return id;
+    }
+
+    size_t inline Size() const
+    {
+        return Next_.load(std::memory_order_relaxed);
+    }
+};
+
+// ******************************************************
+//                    Work stealing
+// ******************************************************
+
+//
+// Every worker owns a deque of subsets to expand: it takes work from
+// its back and, when it runs dry, steals from the front of the others
+//
+
+struct WorkItem
+{
+    DfsmState Id;
+    Subset Set;
+};
+
+struct WorkQueue
+{
+    std::mutex Mutex;
+    std::deque<WorkItem> Items;
+};
+
+//
+// Expanded subset: its successors by every column (Dead for empty ones)
+//
+
+struct Row
+{
+    DfsmState Id;
+    bool Finite;
+    std::vector<DfsmState> Targets;
+};
+
+//
+// Limits of the calling thread's Budget, checked by every worker:
+// Budget itself is thread-local
+//
+
+struct SharedBudget
+{
+    static size_t const DeadlinePeriod = 4096;
+
+    size_t MaxStates = 0;
+    size_t MaxBytes = 0;
+    std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::time_point::max();
+
+    std::atomic<size_t> Bytes{0};
+
+    void Charge(size_t Size)
+    {
+        if (Bytes.fetch_add(Size, std::memory_order_relaxed) + Size > MaxBytes && MaxBytes != 0)
+            throw BudgetExceeded(BudgetExceeded::Resource::Bytes);
+    }
+
+    void CheckDeadline() const
+    {
+        if (Deadline != std::chrono::steady_clock::time_point::max() &&
+            std::chrono::steady_clock::now() > Deadline)
+            throw BudgetExceeded(BudgetExceeded::Resource::Deadline);
+    }
+};
+
+class ParallelDeterminizer
+{
+protected:
+    CompiledNfa const& Nfa_;
+    SharedBudget& Budget_;
+
+    InterningTable Table_;
+    std::unique_ptr<WorkQueue[]> Queues_;
+    size_t QueuesCount_;
+
+    //
+    // Interned but not yet expanded subsets
+    //
+
+    std::atomic<size_t> Pending_{0};
+    std::atomic<bool> Stop_{false};
+
+    //
+    // First exception of any worker
+    //
+
+    std::mutex FailureMutex_;
+    std::exception_ptr Failure_;
+
+    std::vector<std::vector<Row>> Rows_;
+
+    void Push(size_t Worker, WorkItem Item)
+    {
+        Pending_.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(Queues_[Worker].Mutex);
+        Queues_[Worker].Items.push_back(std::move(Item));
+    }
+
+    bool Pop(size_t Worker, WorkItem& Item)
+    {
+        {
+            auto& own = Queues_[Worker];
+            std::lock_guard<std::mutex> lock(own.Mutex);
+            if (!own.Items.empty())
+            {
+                Item = std::move(own.Items.back());
+                own.Items.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t shift = 1; shift != QueuesCount_; shift++)
+        {
+            auto& victim = Queues_[(Worker + shift) % QueuesCount_];
+            std::lock_guard<std::mutex> lock(victim.Mutex);
+            if (!victim.Items.empty())
+            {
+                Item = std::move(victim.Items.front());
+                victim.Items.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Expand(size_t Worker, WorkItem const& Item, std::vector<uint32_t>& Marks, uint32_t& Generation)
+    {
+        auto alphabetSize = Nfa_.AlphabetSize();
+
+        Budget_.Charge(sizeof(Row) + alphabetSize * sizeof(DfsmState));
+        Row row{Item.Id, false, std::vector<DfsmState>(alphabetSize, CompiledAutomaton::Dead)};
+        for (auto state : Item.Set)
+            row.Finite = row.Finite || Nfa_.Finite(state);
+
+        Subset to;
+        for (size_t column = 0; column != alphabetSize; column++)
+        {
+            Generation++;
+            to.clear();
+
+            for (auto state : Item.Set)
+                for (auto target : Nfa_.Targets(state, column))
+                    if (Marks[target] != Generation)
+                    {
+                        Marks[target] = Generation;
+                        to.push_back(target);
+                    }
+
+            if (to.empty())
+                continue;
+
+            std::sort(to.begin(), to.end());
+
+            bool inserted = false;
+            row.Targets[column] = Table_.Intern(to, inserted);
+
+            if (inserted)
+            {
+                if (Budget_.MaxStates != 0 && Table_.Size() > Budget_.MaxStates)
+                    throw BudgetExceeded(BudgetExceeded::Resource::DfsmStates);
+
+                //
+                // Table node: the subset, its id and the bucket links
+                //
+
+                Budget_.Charge(sizeof(Subset) + to.size() * sizeof(CompiledNfa::StateId) +
+                               sizeof(DfsmState) + 2 * sizeof(void*));
+
+                Push(Worker, {row.Targets[column], to});
+            }
+        }
+
+        Rows_[Worker].push_back(std::move(row));
+    }
+
+public:
+    ParallelDeterminizer(CompiledNfa const& Nfa, size_t Workers, SharedBudget& Budget) :
+        Nfa_(Nfa),
+        Budget_(Budget),
+        Queues_(new WorkQueue[Workers]),
+        QueuesCount_(Workers),
+        Rows_(Workers)
+    {
+    }
+
+    //
+    // Never throws: failure stops all workers and is kept for Failure()
+    //
+
+    void Work(size_t Worker)
+    {
+        try
+        {
+            std::vector<uint32_t> marks(Nfa_.StatesCount(), 0);
+            uint32_t generation = 0;
+            size_t work = 0;
+            WorkItem item;
+
+            while (!Stop_.load(std::memory_order_relaxed))
+            {
+                if (!Pop(Worker, item))
+                {
+                    if (Pending_.load() == 0)
+                        return;
+
+                    Budget_.CheckDeadline();
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                Expand(Worker, item, marks, generation);
+                Pending_.fetch_sub(1);
+
+                work += item.Set.size() * Nfa_.AlphabetSize();
+                if (work >= SharedBudget::DeadlinePeriod)
+                {
+                    work = 0;
+                    Budget_.CheckDeadline();
+                }
+            }
+        }
+
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(FailureMutex_);
+            if (!Failure_)
+                Failure_ = std::current_exception();
+
+            Stop_ = true;
+        }
+    }
+
+    std::exception_ptr Failure()
+    {
+        std::lock_guard<std::mutex> lock(FailureMutex_);
+        return Failure_;
+    }
+
+    void Start()
+    {
+        bool inserted = false;
+        Subset initial = {Nfa_.Initial()};
+        Push(0, {Table_.Intern(initial, inserted), initial});
+    }
+
+    //
+    // Breadth-first from the initial subset, columns in order: temporary
+    // ids depend on the scheduling, the result does not
+    //
+
+    CompiledAutomaton Result()
+    {
+        auto statesCount = Table_.Size();
+        auto alphabetSize = Nfa_.AlphabetSize();
+
+        std::vector<Row> rows(statesCount);
+        for (auto& workerRows : Rows_)
+            for (auto& row : workerRows)
+                rows[row.Id] = std::move(row);
+
+        std::vector<DfsmState> order = {0};
+        std::vector<DfsmState> renumbered(statesCount, CompiledAutomaton::Dead);
+        renumbered[0] = 0;
+
+        for (size_t current = 0; current != order.size(); current++)
+            for (auto to : rows[order[current]].Targets)
+                if (to != CompiledAutomaton::Dead && renumbered[to] == CompiledAutomaton::Dead)
+                {
+                    renumbered[to] = DfsmState(order.size());
+                    order.push_back(to);
+                }
+
+        std::vector<DfsmState> table;
+        std::vector<uint8_t> finite;
+        table.reserve(statesCount * alphabetSize);
+        finite.reserve(statesCount);
+
+        for (auto id : order)
+        {
+            finite.push_back(rows[id].Finite);
+            for (auto to : rows[id].Targets)
+                table.push_back(to == CompiledAutomaton::Dead ? to : renumbered[to]);
+        }
+
+        return CompiledAutomaton::FromTable(Nfa_.Symbols(), std::move(table), std::move(finite));
+    }
+};
+
+// ******************************************************
+//                      Interface
+// ******************************************************
+
+CompiledAutomaton DeterminizeParallel(CompiledNfa const& Nfa, size_t Threads)
+{
+    if (Threads == 0)
+        Threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+
+    SharedBudget shared;
+    auto budget = Budget::Current();
+    if (budget != nullptr)
+    {
+        shared.MaxStates = budget->GetLimits().MaxDfsmStates;
+        shared.MaxBytes = budget->GetLimits().MaxBytes;
+        shared.Deadline = budget->Deadline();
+        shared.Bytes = budget->UsedBytes();
+    }
+
+    auto usedBefore = shared.Bytes.load();
+
+    ParallelDeterminizer determinizer(Nfa, Threads, shared);
+    determinizer.Start();
+
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < Threads; worker++)
+        workers.emplace_back([&determinizer, worker]() { determinizer.Work(worker); });
+
+    determinizer.Work(0);
+
+    for (auto& worker : workers)
+        worker.join();
+
+    if (auto failure = determinizer.Failure())
+        std::rethrow_exception(failure);
+
+    //
+    // Within the limit, so it does not throw
+    //
+
+    Budget::ChargeBytes(shared.Bytes - usedBefore);
+    return determinizer.Result();
+}
+
+
+CompiledAutomaton CompileRegexpParallel(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet, size_t Threads)
+{
+    return DeterminizeParallel(CompileNfa(ReversePolishRegexp, Alphabet), Threads);
+}
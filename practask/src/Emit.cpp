@@ -0,0 +1,108 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Emit.cpp
+
+Abstract:
+
+    DFSM to C++ code generator implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <cctype>
+#include <Emit.h>
+
+//
+// Definitions
+//
+
+void EmitState(CompiledAutomaton const& Automaton, CompiledAutomaton::StateId State, std::ostream& Stream)
+{
+    Stream << "s" << State << ":\n";
+
+    //
+    // Accepting state updates the longest accepted prefix inline
+    //
+
+    if (Automaton.Finite(State))
+        Stream << "    longest = size_t(position - begin);\n";
+
+    Stream << "    if (position == end)\n"
+              "        return longest;\n\n"
+              "    switch (*position++)\n"
+              "    {\n";
+
+    for (auto sym : Automaton.Symbols())
+    {
+        auto to = Automaton.Step(State, sym);
+        if (to == CompiledAutomaton::Dead)
+            continue;
+
+        Stream << "        case " << int(sym);
+        if (isprint(uint8_t(sym)) && sym != '\'' && sym != '\\')
+            Stream << " /* '" << sym << "' */";
+
+        Stream << ": goto s" << to << ";\n";
+    }
+
+    Stream << "        default: return longest;\n"
+              "    }\n\n";
+}
+
+
+void EmitCpp(CompiledAutomaton const& Automaton, std::string const& FunctionName, std::ostream& Stream, std::string const& Comment)
+{
+    Stream << "//\n"
+              "// Generated by regsolver --emit-cpp, do not edit\n";
+
+    if (!Comment.empty())
+    {
+        auto comment = Comment;
+        for (auto& sym : comment)
+            if (sym == '\n' || sym == '\r')
+                sym = ' ';
+
+        Stream << "// " << comment << "\n";
+    }
+
+    Stream << "// States: " << Automaton.StatesCount() << "\n"
+              "//\n\n"
+              "#include <stddef.h>\n\n";
+
+    Stream << "static size_t " << FunctionName << "TryAccept(char const* begin, char const* end)\n"
+              "{\n"
+              "    char const* position = begin;\n"
+              "    size_t longest = 0;\n"
+              "    goto s0;\n\n";
+
+    for (CompiledAutomaton::StateId state = 0; state != Automaton.StatesCount(); state++)
+        EmitState(Automaton, state, Stream);
+
+    Stream << "}\n\n";
+
+    Stream << "size_t " << FunctionName << "(char const* Word, size_t WordLength)\n"
+              "{\n"
+              "    size_t longest = 0;\n\n"
+              "    for (size_t start = 0; start != WordLength && longest < WordLength - start; start++)\n"
+              "    {\n"
+              "        size_t accepted = " << FunctionName << "TryAccept(Word + start, Word + WordLength);\n"
+              "        if (accepted > longest)\n"
+              "            longest = accepted;\n"
+              "    }\n\n"
+              "    return longest;\n"
+              "}\n";
+}
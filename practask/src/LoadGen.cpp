@@ -0,0 +1,123 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    LoadGen.cpp
+
+Abstract:
+
+    Load generator for regsolver server.
+
+    Usage:
+        regload <socket> <regexp> <word> [--alphabet abc]
+                [--connections N] [--requests M]
+
+    Opens N connections, each sends M queries back to back. Prints
+    throughput, client-side latency and the server stats report.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <Protocol.h>
+#include <Stats.h>
+
+//
+// Definitions
+//
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <socket> <regexp> <word> "
+                     "[--alphabet abc] [--connections N] [--requests M]\n";
+        return 1;
+    }
+
+    std::string socket = argv[1], regexp = argv[2], word = argv[3];
+    std::string alphabet = "abc";
+    size_t connections = 4;
+    size_t requests = 10000;
+
+    for (int idx = 4; idx + 1 < argc; idx += 2)
+    {
+        if (!strcmp(argv[idx], "--alphabet"))
+            alphabet = argv[idx + 1];
+
+        else if (!strcmp(argv[idx], "--connections"))
+            connections = std::stoul(argv[idx + 1]);
+
+        else if (!strcmp(argv[idx], "--requests"))
+            requests = std::stoul(argv[idx + 1]);
+    }
+
+    try
+    {
+        std::cout << "answer " << Client(socket).Solve(regexp, alphabet, word) << "\n";
+
+        LatencyHistogram latency;
+        std::atomic<size_t> failed{0};
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t idx = 0; idx != connections; idx++)
+        {
+            threads.emplace_back([&]()
+            {
+                try
+                {
+                    Client client(socket);
+                    for (size_t request = 0; request != requests; request++)
+                    {
+                        auto sent = std::chrono::steady_clock::now();
+                        client.Solve(regexp, alphabet, word);
+                        latency.Record(std::chrono::steady_clock::now() - sent);
+                    }
+                }
+
+                catch (const std::exception& e)
+                {
+                    failed++;
+                    std::cerr << "Error!" << e.what() << '\n';
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        auto total = latency.Total();
+
+        std::cout << "requests " << total << "\n";
+        std::cout << "failed_connections " << failed << "\n";
+        std::cout << "seconds " << elapsed.count() << "\n";
+        std::cout << "requests_per_second " << double(total) / elapsed.count() << "\n";
+        latency.Report(std::cout);
+
+        std::cout << "\n-- server --\n" << Client(socket).Stats();
+    }
+
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error!" << e.what() << '\n';
+        return 1;
+    }
+}
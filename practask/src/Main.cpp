@@ -10,12 +10,38 @@ Abstract:
 
     Entry point definition.
 
+    Usage:
+        regsolver [--alphabet abc]
+            Reads single regexp and word from stdin.
+
+        regsolver --batch [file] [--threads N] [--alphabet abc]
+            Reads queries line by line from file (stdin by default),
+            see Batch.h.
+
+        regsolver --serve <socket> [--threads N]
+            Serves queries over a Unix domain socket, see Server.h
+            and Protocol.h. Stops on SIGINT / SIGTERM.
+
+        Batch and server queries may be limited (see Budget.h) with
+            [--max-states N] [--max-bytes N] [--timeout-ms N]
+        and share at most [--cache-size N] compiled automatons of each
+        kind (see Cache.h, 0 for unbounded).
+
+        regsolver --emit-cpp <regexp> [--name Match] [--output file] [--alphabet abc]
+            Generates C++ matcher from the minimized DFSM, see Emit.h.
+
 Author / Creation date:
 
     JulesIMF / 05.11.22
 
 Revision History:
 
+    19.10.26 -- batch mode, alphabet option
+    19.10.26 -- server mode
+    19.10.26 -- C++ code generation
+    19.10.26 -- query limits
+    19.10.26 -- cache size option
+
 --*/
 
 
@@ -23,34 +49,184 @@ Revision History:
 // Includes / usings
 //
 
+#include <csignal>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <Batch.h>
+#include <Emit.h>
+#include <Server.h>
 #include <Task.h>
 
 //
 // Definitions
 //
 
-int main()
+struct Options
+{
+    bool Batch = false;
+    std::string Input;
+    std::string Socket;
+    std::string EmitRegexp;
+    std::string EmitName = "Match";
+    std::string Output;
+    size_t Threads = 0;
+    size_t CacheSize = AutomataCache::DefaultCapacity;
+    AlphabetType Alphabet = { 'a', 'b', 'c' };
+    Limits QueryLimits;
+};
+
+Options ParseOptions(int argc, char** argv)
+{
+    Options options;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        auto hasValue = (idx + 1 < argc);
+
+        if (!strcmp(argv[idx], "--batch"))
+        {
+            options.Batch = true;
+            if (hasValue && argv[idx + 1][0] != '-')
+                options.Input = argv[++idx];
+        }
+
+        else if (!strcmp(argv[idx], "--serve") && hasValue)
+            options.Socket = argv[++idx];
+
+        else if (!strcmp(argv[idx], "--emit-cpp") && hasValue)
+            options.EmitRegexp = argv[++idx];
+
+        else if (!strcmp(argv[idx], "--name") && hasValue)
+            options.EmitName = argv[++idx];
+
+        else if (!strcmp(argv[idx], "--output") && hasValue)
+            options.Output = argv[++idx];
+
+        else if (!strcmp(argv[idx], "--threads") && hasValue)
+            options.Threads = std::stoul(argv[++idx]);
+
+        else if (!strcmp(argv[idx], "--max-states") && hasValue)
+            options.QueryLimits.MaxDfsmStates = std::stoul(argv[++idx]);
+
+        else if (!strcmp(argv[idx], "--max-bytes") && hasValue)
+            options.QueryLimits.MaxBytes = std::stoul(argv[++idx]);
+
+        else if (!strcmp(argv[idx], "--timeout-ms") && hasValue)
+            options.QueryLimits.Timeout = std::chrono::milliseconds(std::stoul(argv[++idx]));
+
+        else if (!strcmp(argv[idx], "--cache-size") && hasValue)
+            options.CacheSize = std::stoul(argv[++idx]);
+
+        else if (!strcmp(argv[idx], "--alphabet") && hasValue)
+        {
+            std::string alphabet = argv[++idx];
+            options.Alphabet = AlphabetType(alphabet.begin(), alphabet.end());
+        }
+
+        else
+            throw std::runtime_error(
+                "Invalid option \'" +
+                std::string(argv[idx]) + "\'");
+    }
+
+    return options;
+}
+
+int RunBatchMode(Options const& Options)
+{
+    ThreadPool pool(Options.Threads);
+    AutomataCache cache(Options.CacheSize);
+
+    if (Options.Input.empty())
+    {
+        RunBatch(std::cin, std::cout, Options.Alphabet, pool, cache, Options.QueryLimits);
+        return 0;
+    }
+
+    std::ifstream input(Options.Input);
+    if (!input)
+        throw std::runtime_error(
+            "Can not open \'" + Options.Input + "\'");
+
+    RunBatch(input, std::cout, Options.Alphabet, pool, cache, Options.QueryLimits);
+    return 0;
+}
+
+int RunEmitMode(Options const& Options)
+{
+    auto automaton = Minimize(CompileRegexp(Options.EmitRegexp, Options.Alphabet));
+    auto comment = "Regexp: " + Options.EmitRegexp;
+
+    if (Options.Output.empty())
+    {
+        EmitCpp(automaton, Options.EmitName, std::cout, comment);
+        return 0;
+    }
+
+    std::ofstream output(Options.Output);
+    if (!output)
+        throw std::runtime_error(
+            "Can not open \'" + Options.Output + "\'");
+
+    EmitCpp(automaton, Options.EmitName, output, comment);
+    return 0;
+}
+
+Server* ActiveServer = nullptr;
+
+void StopServer(int)
+{
+    if (ActiveServer != nullptr)
+        ActiveServer->Stop();
+}
+
+int RunServerMode(Options const& Options)
+{
+    ThreadPool pool(Options.Threads);
+    Server server(Options.Socket, pool, Options.QueryLimits, Options.CacheSize);
+    ActiveServer = &server;
+
+    //
+    // No SA_RESTART, so that accept() is interrupted
+    //
+
+    struct sigaction action = {};
+    action.sa_handler = StopServer;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    server.Serve();
+
+    ActiveServer = nullptr;
+    return 0;
+}
+
+int main(int argc, char** argv)
 {
-    std::string regexp, word;
-    std::cin >> regexp >> word;
     try
     {
-        AlphabetType alphabet = { 'a', 'b', 'c' };
-        for (size_t idx = 0; idx != word.length(); idx++)
-            if (alphabet.find(word[idx]) == alphabet.end())
-                throw std::runtime_error(
-                    "Invalid symbol \'" +
-                    std::string(1, word[idx]) +
-                    "\' (word_idx = " +
-                    std::to_string(idx) + ")");
-
-        auto ans = SolveTask13(regexp, word, alphabet);
+        auto options = ParseOptions(argc, argv);
+        if (options.Batch)
+            return RunBatchMode(options);
+
+        if (!options.Socket.empty())
+            return RunServerMode(options);
+
+        if (!options.EmitRegexp.empty())
+            return RunEmitMode(options);
+
+        std::string regexp, word;
+        std::cin >> regexp >> word;
+
+        CheckWord(word, options.Alphabet);
+
+        auto ans = SolveTask13(regexp, word, options.Alphabet);
         std::cout << "Task 13 answer is " << ans << "\n";
     }
-    
+
     catch(const std::exception& e)
     {
         std::cerr << "Error!" << e.what() << '\n';
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,364 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Nfa.cpp
+
+Abstract:
+
+    Epsilon-free NDFSM table and matchers implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <Ast.h>
+#include <Budget.h>
+#include <Compiled.h>
+#include <Nfa.h>
+#include <Optimize.h>
+#include <Regexp.h>
+
+//
+// Definitions
+//
+
+CompiledNfa::CompiledNfa()
+{
+    Columns_.fill(-1);
+}
+
+
+CompiledNfa CompiledNfa::FromNfsm(Automaton Nfsm, AlphabetType const& Alphabet)
+{
+    assert(Nfsm.IsValid());
+
+    CompiledNfa compiled;
+    compiled.Symbols_.assign(Alphabet.begin(), Alphabet.end());
+    std::sort(compiled.Symbols_.begin(), compiled.Symbols_.end());
+
+    for (size_t column = 0; column != compiled.Symbols_.size(); column++)
+        compiled.Columns_[uint8_t(compiled.Symbols_[column])] = int16_t(column);
+
+    auto states = CollectReachable(Nfsm.Initial);
+    std::sort(states.begin(), states.end(),
+        [&Nfsm](State* First, State* Second)
+        {
+            if (First == Nfsm.Initial || Second == Nfsm.Initial)
+                return First == Nfsm.Initial && Second != Nfsm.Initial;
+
+            return First->Id() < Second->Id();
+        });
+
+    std::map<State*, StateId> ids;
+    for (auto state : states)
+        ids.emplace(state, StateId(ids.size()));
+
+    auto alphabetSize = compiled.Symbols_.size();
+    compiled.Finite_.assign(states.size(), 0);
+    compiled.Offsets_.reserve(states.size() * alphabetSize + 1);
+
+    for (auto state : states)
+    {
+        compiled.Finite_[ids.at(state)] = state->Finite();
+
+        for (auto sym : compiled.Symbols_)
+        {
+            compiled.Offsets_.push_back(uint32_t(compiled.Targets_.size()));
+
+            for (auto const& transition : state->TransitionsBy(sym))
+                compiled.Targets_.push_back(ids.at(transition.To));
+        }
+    }
+
+    compiled.Offsets_.push_back(uint32_t(compiled.Targets_.size()));
+    return compiled;
+}
+
+
+CompiledNfa CompileNfa(std::string const& ReversePolishRegexp, AlphabetType const& Alphabet)
+{
+    Automaton::StartUsing();
+
+    try
+    {
+        auto automaton = ParseSimplified(ReversePolishRegexp, Alphabet);
+        automaton = RemoveEpsilonTransitions(automaton);
+        automaton = CompactStates(automaton);
+        automaton = RemoveUselessStates(automaton);
+        automaton = CompactStates(ReduceBisimilar(automaton));
+
+        auto compiled = CompiledNfa::FromNfsm(automaton, Alphabet);
+        Automaton::EndUsing();
+        return compiled;
+    }
+
+    catch (...)
+    {
+        Automaton::EndUsing();
+        throw;
+    }
+}
+
+
+//
+// Longest accepted prefix of [Begin, End), Matcher stops at Dead
+//
+
+template <typename Matcher>
+size_t LongestPrefix(Matcher& Automaton, char const* Begin, char const* End)
+{
+    size_t maxAcceptedPrefixLen = 0;
+    auto current = Automaton.Initial();
+    auto position = Begin;
+
+    for (; position != End; position++)
+    {
+        current = Automaton.Step(current, *position);
+        if (current == Matcher::Dead)
+            break;
+
+        if (Automaton.Finite(current))
+            maxAcceptedPrefixLen = size_t(position - Begin) + 1;
+    }
+
+    Budget::Tick(size_t(position - Begin) + 1);
+    return maxAcceptedPrefixLen;
+}
+
+template <typename Matcher>
+size_t LongestSubstring(Matcher& Automaton, std::string_view Word)
+{
+    size_t maxAcceptedSubstrLen = 0;
+    auto end = Word.data() + Word.length();
+
+    for (auto current = Word.data(); current != end; current++)
+    {
+        if (maxAcceptedSubstrLen >= size_t(end - current))
+            break;
+
+        maxAcceptedSubstrLen = std::max(maxAcceptedSubstrLen,
+            LongestPrefix(Automaton, current, end));
+    }
+
+    return maxAcceptedSubstrLen;
+}
+
+// ******************************************************
+//                  NDFSM simulation
+// ******************************************************
+
+//
+// As MatchSession, but a live state may have several targets
+//
+
+size_t SolveNfa(CompiledNfa const& Nfa, std::string_view Word)
+{
+    using StateId = CompiledNfa::StateId;
+    size_t const noStart = SIZE_MAX;
+
+    std::vector<size_t> start(Nfa.StatesCount(), noStart);
+    std::vector<size_t> nextStart(Nfa.StatesCount(), noStart);
+    std::vector<StateId> live, nextLive;
+    live.reserve(Nfa.StatesCount());
+    nextLive.reserve(Nfa.StatesCount());
+
+    size_t longest = 0;
+
+    for (size_t position = 0; position != Word.length(); position++)
+    {
+        if (longest >= Word.length() - position && live.empty())
+            break;
+
+        if (start[Nfa.Initial()] == noStart)
+        {
+            start[Nfa.Initial()] = position;
+            live.push_back(Nfa.Initial());
+        }
+
+        auto column = Nfa.Column(Word[position]);
+        Budget::Tick(live.size() + 1);
+
+        for (auto state : live)
+        {
+            auto from = start[state];
+            start[state] = noStart;
+
+            if (column < 0)
+                continue;
+
+            for (auto to : Nfa.Targets(state, size_t(column)))
+            {
+                if (nextStart[to] == noStart)
+                {
+                    nextStart[to] = from;
+                    nextLive.push_back(to);
+                }
+
+                else
+                    nextStart[to] = std::min(nextStart[to], from);
+            }
+        }
+
+        live.swap(nextLive);
+        nextLive.clear();
+        start.swap(nextStart);
+
+        for (auto state : live)
+            if (Nfa.Finite(state))
+                longest = std::max(longest, position + 1 - start[state]);
+    }
+
+    return longest;
+}
+
+// ******************************************************
+//                      Lazy DFSM
+// ******************************************************
+
+LazyDfsm::LazyDfsm(CompiledNfa const& Nfa, size_t MaxStates) :
+    Nfa_(Nfa),
+    MaxStates_(std::max<size_t>(MaxStates, 2))
+{
+    Intern({Nfa.Initial()});
+}
+
+
+LazyDfsm::StateId LazyDfsm::Intern(std::vector<CompiledNfa::StateId> Set)
+{
+    auto found = Ids_.find(Set);
+    if (found != Ids_.end())
+        return found->second;
+
+    if (Sets_.size() == MaxStates_)
+        Flush();
+
+    auto id = StateId(Sets_.size());
+    bool finite = std::any_of(Set.begin(), Set.end(),
+        [this](CompiledNfa::StateId State) { return Nfa_.Finite(State); });
+
+    Finite_.push_back(finite);
+    Table_.resize(Table_.size() + Nfa_.AlphabetSize(), Unknown);
+    Ids_.emplace(Set, id);
+    Sets_.push_back(std::move(Set));
+
+    return id;
+}
+
+
+void LazyDfsm::Flush()
+{
+    Flushes_++;
+    Ids_.clear();
+    Sets_.clear();
+    Table_.clear();
+    Finite_.clear();
+
+    Intern({Nfa_.Initial()});
+}
+
+
+LazyDfsm::StateId LazyDfsm::Compute(StateId From, size_t Column)
+{
+    std::vector<CompiledNfa::StateId> to;
+    for (auto state : Sets_[From])
+    {
+        auto targets = Nfa_.Targets(state, Column);
+        to.insert(to.end(), targets.begin(), targets.end());
+    }
+
+    if (to.empty())
+    {
+        Table_[From * Nfa_.AlphabetSize() + Column] = Dead;
+        return Dead;
+    }
+
+    std::sort(to.begin(), to.end());
+    to.erase(std::unique(to.begin(), to.end()), to.end());
+
+    //
+    // After a flush From is gone, the edge is simply not cached
+    //
+
+    auto flushes = Flushes_;
+    auto id = Intern(std::move(to));
+
+    if (flushes == Flushes_)
+        Table_[From * Nfa_.AlphabetSize() + Column] = id;
+
+    return id;
+}
+
+
+size_t SolveLazyDfsm(CompiledNfa const& Nfa, std::string_view Word)
+{
+    LazyDfsm automaton(Nfa);
+    return LongestSubstring(automaton, Word);
+}
+
+// ******************************************************
+//                  Bit-parallel NDFSM
+// ******************************************************
+
+BitParallelNfa::BitParallelNfa(CompiledNfa const& Nfa)
+{
+    if (Nfa.StatesCount() > MaxStates)
+        throw std::runtime_error(
+            "Too many states for bit-parallel matching (" +
+            std::to_string(Nfa.StatesCount()) + ")");
+
+    Columns_.fill(-1);
+    for (size_t column = 0; column != Nfa.AlphabetSize(); column++)
+        Columns_[uint8_t(Nfa.Symbols()[column])] = int16_t(column);
+
+    Chunks_ = (Nfa.StatesCount() + 7) / 8;
+    Follow_.assign(Nfa.AlphabetSize() * Chunks_ * 256, 0);
+
+    for (CompiledNfa::StateId state = 0; state != Nfa.StatesCount(); state++)
+        if (Nfa.Finite(state))
+            FiniteMask_ |= StateSet(1) << state;
+
+    for (size_t column = 0; column != Nfa.AlphabetSize(); column++)
+    {
+        for (size_t chunk = 0; chunk != Chunks_; chunk++)
+        {
+            auto follow = Follow_.data() + (column * Chunks_ + chunk) * 256;
+
+            //
+            // Byte with the lowest bit cleared is already filled
+            //
+
+            for (size_t byte = 1; byte != 256; byte++)
+            {
+                auto state = chunk * 8 + size_t(__builtin_ctz(unsigned(byte)));
+                StateSet targets = 0;
+
+                if (state < Nfa.StatesCount())
+                    for (auto to : Nfa.Targets(CompiledNfa::StateId(state), column))
+                        targets |= StateSet(1) << to;
+
+                follow[byte] = follow[byte & (byte - 1)] | targets;
+            }
+        }
+    }
+}
+
+
+size_t SolveBitParallel(CompiledNfa const& Nfa, std::string_view Word)
+{
+    BitParallelNfa automaton(Nfa);
+    return LongestSubstring(automaton, Word);
+}
@@ -24,9 +24,14 @@ Revision History:
 //
 
 // #define DEBUG
+#include <algorithm>
+#include <array>
 #include <bitset>
 #include <queue>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
+#include <Budget.h>
 #include <Optimize.h>
 
 //
@@ -58,11 +63,30 @@ size_t SumSize(DeltaType const& Reachable)
     return sumSize;
 }
 
-DeltaType ReachableByOneStep(char Sym)
+State::StatesContainer ReachableStates(Automaton Auto)
+{
+    State::StatesContainer reachable = {Auto.Initial};
+    std::queue<State*> bfsQueue;
+    bfsQueue.push(Auto.Initial);
+
+    while (!bfsQueue.empty())
+    {
+        auto state = bfsQueue.front();
+        bfsQueue.pop();
+
+        for (auto const& transition : state->Transitions())
+            if (reachable.insert(transition.To).second)
+                bfsQueue.push(transition.To);
+    }
+
+    return reachable;
+}
+
+DeltaType ReachableByOneStep(State::StatesContainer const& States, char Sym)
 {
     DeltaType reachable;
 
-    for (auto state : State::AllocatedStates())
+    for (auto state : States)
     {
         reachable[state] = State::StatesContainer();
 
@@ -74,9 +98,9 @@ DeltaType ReachableByOneStep(char Sym)
     return reachable;
 }
 
-DeltaType Reachable(char Sym)
+DeltaType Reachable(State::StatesContainer const& States, char Sym)
 {
-    DeltaType reachable = ReachableByOneStep(Sym);
+    DeltaType reachable = ReachableByOneStep(States, Sym);
 
     size_t oldSumSize = 0;
     size_t newSumSize = SumSize(reachable);
@@ -87,8 +111,10 @@ DeltaType Reachable(char Sym)
     {
         auto oldReachable = reachable;
 
-        for (auto state : State::AllocatedStates())
+        for (auto state : States)
         {
+            Budget::Tick(oneStepReachable[state].size());
+
             for (auto to : oneStepReachable[state]) // Delta_1
             {
                 // Delta_k = Delta_{k - 1} (Delta_1)
@@ -112,9 +138,9 @@ DeltaType Reachable(char Sym)
 //             Epsilon transitions removal
 // ******************************************************
 
-DeltaType EpsReachable()
+DeltaType EpsReachable(State::StatesContainer const& States)
 {
-    return Reachable(Eps);
+    return Reachable(States, Eps);
 }
 
 void EpsRemovalContractTransitions(DeltaType const& EpsReachable)
@@ -169,9 +195,9 @@ void EpsRemovalAddFinites(DeltaType const& EpsReachable)
     DEBUG_OUT("oldFinites = %zu, newFinites = %zu", oldFinites, newFinites);
 }
 
-void EpsRemovalRemoveEpsTransitions()
+void EpsRemovalRemoveEpsTransitions(State::StatesContainer const& States)
 {
-    for (auto state : State::AllocatedStates())
+    for (auto state : States)
     {
         for (auto transition : state->TransitionsBy(Eps))
             transition.Remove();
@@ -180,7 +206,8 @@ void EpsRemovalRemoveEpsTransitions()
 
 Automaton RemoveEpsilonTransitions(Automaton Auto)
 {
-    DeltaType epsReachable = EpsReachable();
+    auto states = ReachableStates(Auto);
+    DeltaType epsReachable = EpsReachable(states);
 
 #ifdef DEBUG
     PrintReachable(epsReachable);
@@ -188,7 +215,7 @@ Automaton RemoveEpsilonTransitions(Automaton Auto)
 
     EpsRemovalContractTransitions(epsReachable);
     EpsRemovalAddFinites(epsReachable);
-    EpsRemovalRemoveEpsTransitions();
+    EpsRemovalRemoveEpsTransitions(states);
 
     return Automaton(Auto.Initial);
 }
@@ -197,35 +224,21 @@ Automaton RemoveEpsilonTransitions(Automaton Auto)
 //                  NDFSM to DFSM 
 // ******************************************************
 
-std::string NameOfSet(State::StatesContainer set)
-{
-    if (set.empty())
-        return "";
-    
-    std::string name = "";
-    auto statesLeft = set.size();
-
-    for (auto state : set)
-    {
-        name += std::to_string(state->Id());
-        if (--statesLeft)
-            name += "|";
-    }
-
-    return name;
-}
-
 Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet)
 {
+    auto states = ReachableStates(Auto);
     std::map<char, DeltaType> reachableBy;
     for (auto sym : Alphabet)
-        reachableBy[sym] = ReachableByOneStep(sym);
+        reachableBy[sym] = ReachableByOneStep(states, sym);
 
     std::map<State::StatesContainer, State*> newStates;
 
     std::queue<State::StatesContainer> bfsQueqe;
     bfsQueqe.push({Auto.Initial});
-    newStates[{Auto.Initial}] = State::Allocate(NameOfSet({Auto.Initial}));
+    Budget::ChargeDfsmState();
+    auto initial = State::Allocate();
+    initial->SetSubset(State::StatesContainer{Auto.Initial});
+    newStates[{Auto.Initial}] = initial;
 
     while (!bfsQueqe.empty())
     {
@@ -236,6 +249,8 @@ Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet)
 
         for (auto sym : Alphabet)
         {
+            Budget::Tick(set.size());
+
             State::StatesContainer to;
             for (auto state : set)
             {
@@ -250,7 +265,9 @@ Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet)
             
             if (newStatesToIter == newStates.end())
             {
-                auto stateTo = State::Allocate(NameOfSet(to));
+                Budget::ChargeDfsmState();
+                auto stateTo = State::Allocate();
+                stateTo->SetSubset(to);
                 newStates[to] = stateTo;
 
                 state->Connect(stateTo, sym);
@@ -281,4 +298,360 @@ Automaton NdfsmToDfsm(Automaton Auto, AlphabetType const& Alphabet)
     }
 
     return Automaton(newStates[{Auto.Initial}]);
-}
\ No newline at end of file
+}
+
+// ******************************************************
+//           Thompson NDFSM to DFSM (lazy closures)
+// ******************************************************
+
+//
+// Sorted by address, closed under Eps
+//
+
+using ClosedSet = std::vector<State*>;
+
+class ClosureCache
+{
+protected:
+    std::unordered_map<State*, ClosedSet> Closures_;
+
+public:
+    ClosedSet const& Of(State* From)
+    {
+        auto found = Closures_.find(From);
+        if (found != Closures_.end())
+            return found->second;
+
+        ClosedSet closure = {From};
+        std::unordered_set<State*> seen = {From};
+
+        for (size_t current = 0; current != closure.size(); current++)
+        {
+            for (auto const& transition : closure[current]->Transitions())
+                if (transition.Sym == Eps && seen.insert(transition.To).second)
+                    closure.push_back(transition.To);
+        }
+
+        std::sort(closure.begin(), closure.end());
+        Budget::Tick(closure.size());
+
+        return Closures_.emplace(From, std::move(closure)).first->second;
+    }
+};
+
+Automaton ThompsonToDfsm(Automaton Auto, AlphabetType const& Alphabet)
+{
+    std::string symbols(Alphabet.begin(), Alphabet.end());
+    std::array<int16_t, 256> columns;
+    columns.fill(-1);
+    for (size_t column = 0; column != symbols.size(); column++)
+        columns[uint8_t(symbols[column])] = int16_t(column);
+
+    ClosureCache closures;
+    std::map<ClosedSet, State*> newStates;
+    std::queue<ClosedSet> bfsQueue;
+
+    auto intern = [&newStates, &bfsQueue](ClosedSet Set)
+    {
+        auto found = newStates.find(Set);
+        if (found != newStates.end())
+            return found->second;
+
+        Budget::ChargeDfsmState();
+        auto state = State::Allocate();
+        state->SetSubset(Set);
+        for (auto member : Set)
+        {
+            if (member->Finite())
+            {
+                state->SetFinite();
+                break;
+            }
+        }
+
+        newStates.emplace(Set, state);
+        bfsQueue.push(std::move(Set));
+        return state;
+    };
+
+    auto initial = intern(closures.Of(Auto.Initial));
+    std::vector<ClosedSet> to(symbols.size());
+
+    while (!bfsQueue.empty())
+    {
+        auto set = std::move(bfsQueue.front());
+        bfsQueue.pop();
+
+        auto state = newStates.at(set);
+
+        //
+        // One pass over the members collects the targets by every symbol
+        //
+
+        for (auto member : set)
+        {
+            for (auto const& transition : member->Transitions())
+            {
+                if (transition.Sym == Eps || columns[uint8_t(transition.Sym)] < 0)
+                    continue;
+
+                auto const& closure = closures.Of(transition.To);
+                auto& target = to[size_t(columns[uint8_t(transition.Sym)])];
+                target.insert(target.end(), closure.begin(), closure.end());
+            }
+        }
+
+        Budget::Tick(set.size());
+
+        for (size_t column = 0; column != symbols.size(); column++)
+        {
+            auto& target = to[column];
+            if (target.empty())
+                continue;
+
+            std::sort(target.begin(), target.end());
+            target.erase(std::unique(target.begin(), target.end()), target.end());
+
+            state->Connect(intern(std::move(target)), symbols[column]);
+            target.clear();
+        }
+    }
+
+    return Automaton(initial);
+}
+
+// ******************************************************
+//                Useless states removal
+// ******************************************************
+
+State::StatesContainer CoReachableStates(State::StatesContainer const& Reachable)
+{
+    State::StatesContainer coReachable;
+    std::queue<State*> bfsQueue;
+
+    for (auto state : Reachable)
+    {
+        if (state->Finite())
+        {
+            coReachable.insert(state);
+            bfsQueue.push(state);
+        }
+    }
+
+    while (!bfsQueue.empty())
+    {
+        auto state = bfsQueue.front();
+        bfsQueue.pop();
+
+        for (auto const& transition : state->InputTransitions())
+        {
+            if (Reachable.find(transition.From) == Reachable.end())
+                continue;
+
+            if (coReachable.insert(transition.From).second)
+                bfsQueue.push(transition.From);
+        }
+    }
+
+    return coReachable;
+}
+
+Automaton RemoveUselessStates(Automaton Auto)
+{
+    auto reachable = ReachableStates(Auto);
+    auto coReachable = CoReachableStates(reachable);
+    size_t removedTransitions = 0;
+
+    for (auto state : reachable)
+    {
+        std::vector<Transition> useless;
+        for (auto const& transition : state->Transitions())
+            if (coReachable.find(transition.To) == coReachable.end())
+                useless.push_back(transition);
+
+        for (auto& transition : useless)
+            transition.Remove();
+
+        removedTransitions += useless.size();
+    }
+
+    DEBUG_OUT("uselessStates = %zu, removedTransitions = %zu",
+        reachable.size() - coReachable.size(), removedTransitions);
+
+    return Automaton(Auto.Initial);
+}
+
+// ******************************************************
+//                Bisimulation reduction
+// ******************************************************
+
+//
+// Allocation order, so that the merged states are numbered the same
+// in every run
+//
+
+std::vector<State*> SortedById(State::StatesContainer const& States)
+{
+    std::vector<State*> sorted(States.begin(), States.end());
+    std::sort(sorted.begin(), sorted.end(),
+        [](State* First, State* Second) { return First->Id() < Second->Id(); });
+
+    return sorted;
+}
+
+size_t CountTransitions(std::vector<State*> const& States)
+{
+    size_t transitions = 0;
+    for (auto state : States)
+        transitions += state->Transitions().size();
+
+    return transitions;
+}
+
+//
+// Coarsest partition of States (indexed by Index) stable under the
+// transitions: Outputs (forward) or InputTransitions (backward).
+// Classes start from Initial.
+//
+
+std::vector<size_t> RefinePartition
+(
+    std::vector<State*> const& States,
+    std::unordered_map<State*, size_t> const& Index,
+    std::vector<size_t> Initial,
+    bool Forward
+)
+{
+    auto classOf = std::move(Initial);
+    size_t classesCount = 0;
+
+    while (true)
+    {
+        std::map<std::vector<size_t>, size_t> classes;
+        std::vector<size_t> newClassOf(States.size());
+
+        for (size_t idx = 0; idx != States.size(); idx++)
+        {
+            auto const& transitions = Forward ?
+                States[idx]->Transitions() :
+                States[idx]->InputTransitions();
+
+            //
+            // (symbol, class) pairs, sorted and unique
+            //
+
+            std::vector<std::pair<char, size_t>> moves;
+            for (auto const& transition : transitions)
+            {
+                auto other = Index.find(Forward ? transition.To : transition.From);
+                if (other != Index.end())
+                    moves.push_back({transition.Sym, classOf[other->second]});
+            }
+
+            std::sort(moves.begin(), moves.end());
+            moves.erase(std::unique(moves.begin(), moves.end()), moves.end());
+
+            std::vector<size_t> signature(1, classOf[idx]);
+            for (auto const& [sym, to] : moves)
+            {
+                signature.push_back(size_t(uint8_t(sym)));
+                signature.push_back(to);
+            }
+
+            Budget::Tick(signature.size());
+            newClassOf[idx] = classes.emplace(std::move(signature), classes.size()).first->second;
+        }
+
+        classOf.swap(newClassOf);
+        if (classes.size() == classesCount)
+            break;
+
+        classesCount = classes.size();
+    }
+
+    return classOf;
+}
+
+//
+// One new state per class; it is finite if any member is
+//
+
+Automaton MergeClasses(Automaton Auto, std::vector<State*> const& States, std::vector<size_t> const& ClassOf)
+{
+    std::unordered_map<State*, size_t> index;
+    for (size_t idx = 0; idx != States.size(); idx++)
+        index[States[idx]] = idx;
+
+    std::vector<State*> merged(States.size(), nullptr);
+    for (size_t idx = 0; idx != States.size(); idx++)
+    {
+        auto& state = merged[ClassOf[idx]];
+        if (state == nullptr)
+            state = State::Allocate();
+
+        if (States[idx]->Finite())
+            state->SetFinite();
+    }
+
+    for (size_t idx = 0; idx != States.size(); idx++)
+        for (auto const& transition : States[idx]->Transitions())
+            merged[ClassOf[idx]]->Connect(merged[ClassOf[index.at(transition.To)]], transition.Sym);
+
+    return Automaton(merged[ClassOf[index.at(Auto.Initial)]]);
+}
+
+Automaton ReduceBisimilar(Automaton Auto, ReductionStats* Stats)
+{
+    auto states = SortedById(ReachableStates(Auto));
+
+    ReductionStats stats;
+    stats.StatesBefore = states.size();
+    stats.TransitionsBefore = CountTransitions(states);
+
+    while (true)
+    {
+        auto statesCount = states.size();
+
+        for (bool forward : { true, false })
+        {
+            std::unordered_map<State*, size_t> index;
+            for (size_t idx = 0; idx != states.size(); idx++)
+                index[states[idx]] = idx;
+
+            std::vector<size_t> initial(states.size());
+            for (size_t idx = 0; idx != states.size(); idx++)
+                initial[idx] = forward ? states[idx]->Finite() : (states[idx] == Auto.Initial);
+
+            auto classOf = RefinePartition(states, index, std::move(initial), forward);
+            if (size_t(*std::max_element(classOf.begin(), classOf.end())) + 1 == states.size())
+                continue;
+
+            Auto = MergeClasses(Auto, states, classOf);
+            states = SortedById(ReachableStates(Auto));
+        }
+
+        if (states.size() == statesCount)
+            break;
+    }
+
+    stats.StatesAfter = states.size();
+    stats.TransitionsAfter = CountTransitions(states);
+
+    DEBUG_OUT("bisimulation: states %zu -> %zu, transitions %zu -> %zu",
+        stats.StatesBefore, stats.StatesAfter, stats.TransitionsBefore, stats.TransitionsAfter);
+
+    if (Stats != nullptr)
+        *Stats = stats;
+
+    return Auto;
+}
+
+// ******************************************************
+//                      Compaction
+// ******************************************************
+
+Automaton CompactStates(Automaton Auto)
+{
+    State::DestructUnreachable(ReachableStates(Auto));
+    return Auto;
+}
@@ -0,0 +1,230 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    PatternSet.cpp
+
+Abstract:
+
+    Multi-pattern product DFSM implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <map>
+#include <Budget.h>
+#include <PatternSet.h>
+
+//
+// Definitions
+//
+
+PatternSet::PatternSet()
+{
+    Columns_.fill(-1);
+}
+
+
+PatternSet PatternSet::Compile(std::vector<std::string> const& ReversePolishRegexps, AlphabetType const& Alphabet, size_t MaxStates)
+{
+    PatternSet set;
+    set.Symbols_.assign(Alphabet.begin(), Alphabet.end());
+    std::sort(set.Symbols_.begin(), set.Symbols_.end());
+
+    for (size_t column = 0; column != set.Symbols_.size(); column++)
+        set.Columns_[uint8_t(set.Symbols_[column])] = int16_t(column);
+
+    std::vector<CompiledAutomaton> automata;
+    automata.reserve(ReversePolishRegexps.size());
+    for (auto const& regexp : ReversePolishRegexps)
+        automata.push_back(CompileRegexp(regexp, Alphabet));
+
+    set.PatternsCount_ = automata.size();
+
+    for (size_t first = 0; first < automata.size(); first += GroupPatterns)
+    {
+        std::vector<size_t> patterns;
+        for (auto pattern = first; pattern != std::min(first + GroupPatterns, automata.size()); pattern++)
+            patterns.push_back(pattern);
+
+        set.AddGroup(automata, std::move(patterns), MaxStates);
+    }
+
+    return set;
+}
+
+
+void PatternSet::AddGroup(std::vector<CompiledAutomaton> const& Automata, std::vector<size_t> Patterns, size_t MaxStates)
+{
+    //
+    // Single pattern product is just its DFSM
+    //
+
+    auto limit = (Patterns.size() == 1) ? SIZE_MAX : MaxStates;
+    if (BuildGroup(Automata, Patterns, limit))
+        return;
+
+    std::vector<size_t> second(Patterns.begin() + Patterns.size() / 2, Patterns.end());
+    Patterns.resize(Patterns.size() / 2);
+
+    AddGroup(Automata, std::move(Patterns), MaxStates);
+    AddGroup(Automata, std::move(second), MaxStates);
+}
+
+
+//
+// Breadth-first over the reachable tuples, false if there are more than MaxStates
+//
+
+bool PatternSet::BuildGroup(std::vector<CompiledAutomaton> const& Automata, std::vector<size_t> const& Patterns, size_t MaxStates)
+{
+    Group group;
+    group.Patterns = Patterns;
+
+    //
+    // Empty language never gets past 0
+    //
+
+    for (auto pattern : Patterns)
+    {
+        auto const& automaton = Automata[pattern];
+        group.MaxLengths.push_back(automaton.MinLength() == CompiledAutomaton::Unbounded ? 0 : automaton.MaxLength());
+    }
+
+    std::map<std::vector<StateId>, StateId> ids;
+    std::vector<std::vector<StateId>> tuples;
+
+    auto intern = [&](std::vector<StateId> Tuple)
+    {
+        auto found = ids.find(Tuple);
+        if (found != ids.end())
+            return found->second;
+
+        auto id = StateId(tuples.size());
+        PatternMask accepts = 0;
+        for (size_t index = 0; index != Patterns.size(); index++)
+            if (Tuple[index] != Dead && Automata[Patterns[index]].Finite(Tuple[index]))
+                accepts |= PatternMask(1) << index;
+
+        group.Accepts.push_back(accepts);
+        group.Table.resize(group.Table.size() + Symbols_.size(), Dead);
+        ids.emplace(Tuple, id);
+        tuples.push_back(std::move(Tuple));
+
+        Budget::Tick();
+        return id;
+    };
+
+    std::vector<StateId> initial;
+    for (auto pattern : Patterns)
+        initial.push_back(Automata[pattern].Initial());
+
+    intern(std::move(initial));
+
+    for (StateId from = 0; from != tuples.size(); from++)
+    {
+        if (tuples.size() > MaxStates)
+            return false;
+
+        for (size_t column = 0; column != Symbols_.size(); column++)
+        {
+            std::vector<StateId> to(Patterns.size());
+            bool dead = true;
+
+            for (size_t index = 0; index != Patterns.size(); index++)
+            {
+                auto state = tuples[from][index];
+                to[index] = (state == Dead) ? Dead : Automata[Patterns[index]].Step(state, Symbols_[column]);
+                dead = dead && to[index] == Dead;
+            }
+
+            if (!dead)
+            {
+                auto id = intern(std::move(to));
+                group.Table[from * Symbols_.size() + column] = id;
+            }
+        }
+    }
+
+    if (tuples.size() > MaxStates)
+        return false;
+
+    Groups_.push_back(std::move(group));
+    return true;
+}
+
+
+size_t PatternSet::StatesCount() const
+{
+    size_t states = 0;
+    for (auto const& group : Groups_)
+        states += group.Accepts.size();
+
+    return states;
+}
+
+
+std::vector<size_t> PatternSet::Solve(std::string_view Word) const
+{
+    std::vector<size_t> longest(PatternsCount_, 0);
+    auto alphabetSize = Symbols_.size();
+    auto end = Word.data() + Word.length();
+
+    for (auto const& group : Groups_)
+    {
+        //
+        // Patterns whose longest accepted word is already found are done
+        //
+
+        PatternMask open = 0;
+        for (size_t index = 0; index != group.Patterns.size(); index++)
+            if (group.MaxLengths[index] != 0)
+                open |= PatternMask(1) << index;
+
+        std::array<size_t, GroupPatterns> lengths = {};
+
+        for (auto current = Word.data(); current != end && open != 0; current++)
+        {
+            auto state = StateId(0); // initial
+            auto position = current;
+            for (; position != end; position++)
+            {
+                auto column = Columns_[uint8_t(*position)];
+                if (column < 0)
+                    break;
+
+                state = group.Table[state * alphabetSize + size_t(column)];
+                if (state == Dead)
+                    break;
+
+                for (auto accepts = group.Accepts[state] & open; accepts != 0; accepts &= accepts - 1)
+                {
+                    auto index = size_t(__builtin_ctzll(accepts));
+                    auto length = lengths[index] = std::max(lengths[index], size_t(position - current) + 1);
+                    if (length == group.MaxLengths[index])
+                        open &= ~(PatternMask(1) << index);
+                }
+            }
+
+            Budget::Tick(size_t(position - current) + 1);
+        }
+
+        for (size_t index = 0; index != group.Patterns.size(); index++)
+            longest[group.Patterns[index]] = lengths[index];
+    }
+
+    return longest;
+}
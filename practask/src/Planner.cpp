@@ -0,0 +1,327 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Planner.cpp
+
+Abstract:
+
+    Execution engine choice implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Budget.h>
+#include <Nfa.h>
+#include <Planner.h>
+#include <Regexp.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+char const* EngineName(Engine Kind)
+{
+    switch (Kind)
+    {
+        case Engine::Dfsm:        return "dfsm";
+        case Engine::LazyDfsm:    return "lazy_dfsm";
+        case Engine::Nfa:         return "nfa";
+        case Engine::BitParallel: return "bit_parallel";
+    }
+
+    return "unknown";
+}
+
+// ******************************************************
+//                    Regexp shape
+// ******************************************************
+
+struct SubexpressionShape
+{
+    RegexpShape Shape;
+    size_t Alternatives = 1;
+
+    //
+    // log2 of the alternative paths through the subexpression
+    //
+
+    size_t Width = 0;
+    bool Loops = false;
+
+    std::bitset<256> First;
+    bool Nullable = false;
+};
+
+size_t CeilLog2(size_t Value)
+{
+    size_t log = 0;
+    while ((size_t(1) << log) < Value)
+        log++;
+
+    return log;
+}
+
+RegexpShape AnalyzeShape(std::string const& ReversePolishRegexp)
+{
+    std::vector<SubexpressionShape> stack;
+
+    for (auto sym : ReversePolishRegexp)
+    {
+        if (isspace(sym))
+            continue;
+
+        if (sym == SYM_KLEENE)
+        {
+            if (stack.empty())
+                break;
+
+            auto& source = stack.back();
+            source.Shape.ThompsonStates += 1;
+            source.Shape.StarDepth += 1;
+            source.Alternatives = 1;
+            source.Width = 0;
+            source.Loops = true;
+            source.Nullable = true;
+            continue;
+        }
+
+        if (sym == SYM_CONCAT || sym == SYM_UNION)
+        {
+            if (stack.size() < 2)
+                break;
+
+            auto second = stack.back(); stack.pop_back();
+            auto& first = stack.back();
+
+            //
+            // Every path of the second operand may start
+            // at any iteration of the loops of the first one
+            //
+
+            auto& shape = first.Shape;
+            auto branching = std::max(shape.Branching, second.Shape.Branching);
+            if (sym == SYM_CONCAT)
+                branching = shape.Branching + second.Shape.Branching + (first.Loops ? second.Width : 0);
+
+            shape.ThompsonStates += second.Shape.ThompsonStates + (sym == SYM_UNION ? 2 : 0);
+            shape.Symbols += second.Shape.Symbols;
+            shape.StarDepth = std::max(shape.StarDepth, second.Shape.StarDepth);
+            shape.UnionFanout = std::max(shape.UnionFanout, second.Shape.UnionFanout);
+            shape.Branching = branching;
+
+            if (sym == SYM_CONCAT)
+            {
+                first.Alternatives = 1;
+                first.Width += second.Width;
+            }
+
+            else
+            {
+                first.Alternatives += second.Alternatives;
+                first.Width = std::max({first.Width, second.Width, CeilLog2(first.Alternatives)});
+                shape.UnionFanout = std::max(shape.UnionFanout, first.Alternatives);
+            }
+
+            if (sym == SYM_CONCAT && first.Nullable)
+                first.First |= second.First;
+
+            if (sym == SYM_UNION)
+                first.First |= second.First;
+
+            first.Nullable = (sym == SYM_CONCAT) ?
+                (first.Nullable && second.Nullable) :
+                (first.Nullable || second.Nullable);
+
+            first.Loops = first.Loops || second.Loops;
+            continue;
+        }
+
+        SubexpressionShape leaf;
+        leaf.Shape.ThompsonStates = 2;
+        leaf.Shape.Symbols = (sym != SYM_ONE);
+        leaf.Nullable = (sym == SYM_ONE);
+        if (sym != SYM_ONE)
+            leaf.First.set(uint8_t(sym));
+
+        stack.push_back(leaf);
+    }
+
+    if (stack.empty())
+        return RegexpShape();
+
+    auto shape = stack.back().Shape;
+    shape.FirstSymbols = stack.back().First.count();
+    return shape;
+}
+
+// ******************************************************
+//                     Cost model
+// ******************************************************
+
+//
+// Nanoseconds, measured with bench 'planner' on random words
+//
+
+double const FrontEndCost    = 1000.0; // per Thompson state and star level
+double const DeterminizeCost = 150.0;  // per DFSM state, symbol and NDFSM state
+double const DfsmScanCost    = 0.5;    // prefilter, per byte
+double const DfsmStartCost   = 25.0;
+double const DfsmStepCost    = 1.5;
+double const LazyStartCost   = 18.0;
+double const LazyStepCost    = 2.0;
+double const LazyMissCost    = 90.0;   // per NDFSM state of the subset
+double const NfaByteCost     = 25.0;
+double const NfaLiveCost     = 3.0;    // per live state and byte
+double const BitTableCost    = 4.5;    // per table entry
+double const BitStartCost    = 10.0;
+double const BitStepCost     = 1.5;    // per byte of the state set
+
+QueryPlan PlanQuery(std::string const& ReversePolishRegexp, size_t AlphabetSize, size_t WordLength, bool DfsmCached, bool NfaCached)
+{
+    QueryPlan plan;
+    auto const& shape = plan.Shape = AnalyzeShape(ReversePolishRegexp);
+
+    double nfaStates = double(shape.Symbols + 1);
+    double alphabet = double(std::max<size_t>(AlphabetSize, 1));
+    double word = double(WordLength);
+
+    //
+    // Subsets are sets of positions, and every union alternative
+    // after a loop doubles them
+    //
+
+    double dfsmStates = std::max(nfaStates, std::pow(2.0, double(std::min<size_t>(shape.Branching + 1, 40))));
+    dfsmStates = std::min(dfsmStates, std::pow(2.0, std::min(nfaStates, 40.0)));
+
+    //
+    // Symbols stepped from every start: an attempt usually dies within
+    // a few positions, but under a star it may run on (and Nfa does not
+    // care), so the window grows with the word
+    //
+
+    double window = 1 + nfaStates / 2;
+    if (shape.StarDepth != 0)
+        window += std::sqrt(word);
+
+    window = std::min(window, word);
+    double stepped = word * window;
+
+    double frontEnd = FrontEndCost * double(shape.ThompsonStates) * double(1 + shape.StarDepth);
+    double nfaFrontEnd = NfaCached ? 0.0 : frontEnd;
+
+    //
+    // Dfsm prefilter skips starts with no transition from the initial state
+    //
+
+    double starts = word * std::min(1.0, double(shape.FirstSymbols) / alphabet);
+
+    double determinize = DeterminizeCost * dfsmStates * alphabet * nfaStates;
+    plan.Costs[size_t(Engine::Dfsm)] = (DfsmCached ? 0.0 : frontEnd + determinize) +
+        DfsmScanCost * word + DfsmStartCost * starts + DfsmStepCost * starts * window;
+
+    auto budget = Budget::Current();
+    if (!DfsmCached && budget != nullptr && budget->GetLimits().MaxDfsmStates != 0 &&
+        dfsmStates > double(budget->GetLimits().MaxDfsmStates))
+        plan.Costs[size_t(Engine::Dfsm)] = std::numeric_limits<double>::infinity();
+
+    double misses = std::min(dfsmStates * alphabet, stepped);
+    plan.Costs[size_t(Engine::LazyDfsm)] = nfaFrontEnd + LazyMissCost * misses * nfaStates +
+        LazyStartCost * word + LazyStepCost * stepped;
+
+    double live = std::min(nfaStates, double(2 + shape.StarDepth + shape.Branching));
+    plan.Costs[size_t(Engine::Nfa)] = nfaFrontEnd + (NfaByteCost + NfaLiveCost * live) * word;
+
+    double chunks = std::ceil(nfaStates / 8);
+    plan.Costs[size_t(Engine::BitParallel)] = (nfaStates > double(BitParallelNfa::MaxStates)) ?
+        std::numeric_limits<double>::infinity() :
+        nfaFrontEnd + BitTableCost * alphabet * chunks * 256 + BitStartCost * word + BitStepCost * stepped * chunks;
+
+    auto cheapest = std::min_element(plan.Costs.begin(), plan.Costs.end());
+    plan.Chosen = Engine(cheapest - plan.Costs.begin());
+    return plan;
+}
+
+// ******************************************************
+//                      Execution
+// ******************************************************
+
+size_t SolveWithEngine(Engine Kind, std::string const& ReversePolishRegexp, std::string_view Word, AlphabetType const& Alphabet, AutomataCache* Cache)
+{
+    if (Kind == Engine::Dfsm)
+    {
+        if (Cache != nullptr)
+            return SolveTask13(*Cache->Get(ReversePolishRegexp, Alphabet), Word);
+
+        return SolveTask13(CompileRegexp(ReversePolishRegexp, Alphabet), Word);
+    }
+
+    auto nfa = (Cache != nullptr) ?
+        Cache->GetNfa(ReversePolishRegexp, Alphabet) :
+        std::make_shared<CompiledNfa const>(CompileNfa(ReversePolishRegexp, Alphabet));
+
+    switch (Kind)
+    {
+        case Engine::LazyDfsm:    return SolveLazyDfsm(*nfa, Word);
+        case Engine::BitParallel: return SolveBitParallel(*nfa, Word);
+        default:                  return SolveNfa(*nfa, Word);
+    }
+}
+
+
+size_t RunPlan(QueryPlan& Plan, std::string const& ReversePolishRegexp, std::string_view Word, AlphabetType const& Alphabet, AutomataCache* Cache)
+{
+    try
+    {
+        return SolveWithEngine(Plan.Chosen, ReversePolishRegexp, Word, Alphabet, Cache);
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        if (Plan.Chosen != Engine::Dfsm || e.Exhausted() == BudgetExceeded::Resource::Deadline)
+            throw;
+    }
+
+    //
+    // Abandoned DFSM is already freed
+    //
+
+    if (Budget::Current() != nullptr)
+        Budget::Current()->ResetUsage();
+
+    Plan.Chosen = Engine::Nfa;
+    Plan.FellBack = true;
+    return SolveWithEngine(Plan.Chosen, ReversePolishRegexp, Word, Alphabet, Cache);
+}
+
+
+size_t SolvePlanned(std::string const& ReversePolishRegexp, std::string_view Word, AlphabetType const& Alphabet, AutomataCache* Cache, QueryPlan* Plan)
+{
+    bool dfsmCached = (Cache != nullptr) && Cache->Contains(ReversePolishRegexp, Alphabet);
+    bool nfaCached = (Cache != nullptr) && Cache->ContainsNfa(ReversePolishRegexp, Alphabet);
+
+    QueryPlan plan;
+    auto& chosen = (Plan != nullptr) ? *Plan : plan;
+
+    chosen = PlanQuery(ReversePolishRegexp, Alphabet.size(), Word.length(), dfsmCached, nfaCached);
+    return RunPlan(chosen, ReversePolishRegexp, Word, Alphabet, Cache);
+}
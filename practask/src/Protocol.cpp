@@ -0,0 +1,287 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Protocol.cpp
+
+Abstract:
+
+    regsolver server protocol implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Protocol.h>
+
+//
+// Definitions
+//
+
+// ******************************************************
+//                        Frames
+// ******************************************************
+
+std::runtime_error SystemError(std::string const& What)
+{
+    return std::runtime_error(What + ": " + strerror(errno));
+}
+
+//
+// Returns number of bytes read, less than Size only on EOF
+//
+
+size_t ReadAll(int Fd, char* Buffer, size_t Size)
+{
+    size_t done = 0;
+    while (done != Size)
+    {
+        auto got = read(Fd, Buffer + done, Size - done);
+        if (got == 0)
+            break;
+
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw SystemError("read");
+        }
+
+        done += size_t(got);
+    }
+
+    return done;
+}
+
+void WriteAll(int Fd, char const* Buffer, size_t Size)
+{
+    size_t done = 0;
+    while (done != Size)
+    {
+        auto put = send(Fd, Buffer + done, Size - done, MSG_NOSIGNAL);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw SystemError("send");
+        }
+
+        done += size_t(put);
+    }
+}
+
+bool ReadFrame(int Fd, std::string& Frame)
+{
+    uint32_t length = 0;
+    auto got = ReadAll(Fd, reinterpret_cast<char*>(&length), sizeof(length));
+    if (got == 0)
+        return false;
+
+    if (got != sizeof(length))
+        throw std::runtime_error("Truncated frame header");
+
+    if (length > MaxFrameLength)
+        throw std::runtime_error(
+            "Frame is too long (length = " +
+            std::to_string(length) + ")");
+
+    Frame.resize(length);
+    if (ReadAll(Fd, Frame.data(), length) != length)
+        throw std::runtime_error("Truncated frame body");
+
+    return true;
+}
+
+bool TakeFrame(std::string& Buffer, std::string& Frame)
+{
+    uint32_t length = 0;
+    if (Buffer.length() < sizeof(length))
+        return false;
+
+    memcpy(&length, Buffer.data(), sizeof(length));
+    if (length > MaxFrameLength)
+        throw std::runtime_error(
+            "Frame is too long (length = " +
+            std::to_string(length) + ")");
+
+    if (Buffer.length() - sizeof(length) < length)
+        return false;
+
+    Frame.assign(Buffer, sizeof(length), length);
+    Buffer.erase(0, sizeof(length) + length);
+    return true;
+}
+
+void WriteFrame(int Fd, std::string_view Frame)
+{
+    uint32_t length = uint32_t(Frame.length());
+
+    std::string buffer(reinterpret_cast<char const*>(&length), sizeof(length));
+    buffer += Frame;
+    WriteAll(Fd, buffer.data(), buffer.length());
+}
+
+// ******************************************************
+//                       Messages
+// ******************************************************
+
+void PutString(std::string& Frame, std::string_view String)
+{
+    uint32_t length = uint32_t(String.length());
+    Frame.append(reinterpret_cast<char const*>(&length), sizeof(length));
+    Frame += String;
+}
+
+std::string_view GetString(std::string_view& Frame)
+{
+    uint32_t length = 0;
+    if (Frame.length() < sizeof(length))
+        throw std::runtime_error("Malformed query");
+
+    memcpy(&length, Frame.data(), sizeof(length));
+    Frame.remove_prefix(sizeof(length));
+
+    if (Frame.length() < length)
+        throw std::runtime_error("Malformed query");
+
+    auto string = Frame.substr(0, length);
+    Frame.remove_prefix(length);
+    return string;
+}
+
+std::string EncodeQuery(std::string_view Regexp, std::string_view Alphabet, std::string_view Word)
+{
+    std::string frame(1, char(REQUEST_QUERY));
+    PutString(frame, Regexp);
+    PutString(frame, Alphabet);
+    PutString(frame, Word);
+    return frame;
+}
+
+Query DecodeQuery(std::string_view Frame)
+{
+    if (Frame.empty() || Frame[0] != REQUEST_QUERY)
+        throw std::runtime_error("Malformed query");
+
+    Frame.remove_prefix(1);
+
+    Query query;
+    query.Regexp = GetString(Frame);
+    query.Alphabet = GetString(Frame);
+    query.Word = GetString(Frame);
+
+    if (!Frame.empty())
+        throw std::runtime_error("Malformed query");
+
+    return query;
+}
+
+std::string EncodeAnswer(uint64_t Answer)
+{
+    std::string frame(1, char(RESPONSE_OK));
+    frame.append(reinterpret_cast<char const*>(&Answer), sizeof(Answer));
+    return frame;
+}
+
+std::string EncodeBudgetExceeded(BudgetExceeded::Resource Exhausted)
+{
+    std::string frame(1, char(RESPONSE_BUDGET));
+    frame += char(Exhausted);
+    return frame;
+}
+
+uint64_t DecodeAnswer(std::string_view Frame)
+{
+    if (!Frame.empty() && Frame[0] == RESPONSE_ERROR)
+        throw std::runtime_error(std::string(Frame.substr(1)));
+
+    if (Frame.length() == 2 && Frame[0] == RESPONSE_BUDGET &&
+        uint8_t(Frame[1]) <= uint8_t(BudgetExceeded::Resource::Deadline))
+        throw BudgetExceeded(BudgetExceeded::Resource(Frame[1]));
+
+    uint64_t answer = 0;
+    if (Frame.length() != 1 + sizeof(answer) || Frame[0] != RESPONSE_OK)
+        throw std::runtime_error("Malformed answer");
+
+    memcpy(&answer, Frame.data() + 1, sizeof(answer));
+    return answer;
+}
+
+// ******************************************************
+//                        Client
+// ******************************************************
+
+int ConnectUnixSocket(std::string const& Path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (Path.length() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path is too long");
+
+    strcpy(address.sun_path, Path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw SystemError("socket");
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        auto error = SystemError("connect");
+        close(fd);
+        throw error;
+    }
+
+    return fd;
+}
+
+Client::Client(std::string const& Path) :
+    Fd_(ConnectUnixSocket(Path))
+{
+}
+
+Client::~Client()
+{
+    close(Fd_);
+}
+
+std::string_view Client::Exchange(std::string_view Request)
+{
+    WriteFrame(Fd_, Request);
+    if (!ReadFrame(Fd_, Frame_))
+        throw std::runtime_error("Server closed connection");
+
+    return Frame_;
+}
+
+uint64_t Client::Solve(std::string_view Regexp, std::string_view Alphabet, std::string_view Word)
+{
+    return DecodeAnswer(Exchange(EncodeQuery(Regexp, Alphabet, Word)));
+}
+
+std::string Client::Stats()
+{
+    auto frame = Exchange(std::string(1, char(REQUEST_STATS)));
+    if (frame.empty() || frame[0] != RESPONSE_OK)
+        throw std::runtime_error("Malformed stats");
+
+    return std::string(frame.substr(1));
+}
@@ -24,8 +24,12 @@ Revision History:
 //
 
 #include <cctype>
+#include <cstdint>
 #include <stdexcept>
 #include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <Regexp.h>
 
 //
@@ -36,7 +40,7 @@ Automaton CreateSymbol(char Sym)
 {
     assert(Sym != Eps);
 
-    State* initial = State::Allocate(std::string(1, Sym));
+    State* initial = State::Allocate(Sym);
     State* finite  = State::Allocate();
     finite->SetFinite();
 
@@ -47,7 +51,7 @@ Automaton CreateSymbol(char Sym)
 
 Automaton CreateOne()
 {
-    State* initial = State::Allocate(std::string(1, SYM_ONE));
+    State* initial = State::Allocate(SYM_ONE);
     State* finite = State::Allocate();
     finite->SetFinite();
 
@@ -63,7 +67,7 @@ Automaton CreateConcat(Automaton First, Automaton Second)
 
     // No special states
     First.Finite->Connect(Second.Initial, Eps);
-    First.Finite->SetName(std::string(1, SYM_CONCAT));
+    First.Finite->SetOrigin(SYM_CONCAT);
     First.Finite->UnsetFinite();
     return Automaton(First.Initial, Second.Finite);
 }
@@ -74,7 +78,7 @@ Automaton CreateUnion(Automaton First, Automaton Second)
     assert(First.IsSingleFiniteValid() &&
            Second.IsSingleFiniteValid());
 
-    State* initial = State::Allocate(std::string(1, SYM_UNION));
+    State* initial = State::Allocate(SYM_UNION);
     State* finite = State::Allocate();
     finite->SetFinite();
 
@@ -95,7 +99,7 @@ Automaton CreateKleene(Automaton Source)
 {
     assert(Source.IsSingleFiniteValid());
 
-    State* singleState = State::Allocate(std::string(1, SYM_KLEENE));
+    State* singleState = State::Allocate(SYM_KLEENE);
     singleState->SetFinite();
 
     singleState->Connect(Source.Initial, Eps);
@@ -105,6 +109,43 @@ Automaton CreateKleene(Automaton Source)
 }
 
 
+Automaton CreateTrie(std::vector<std::string> const& Words)
+{
+    State* initial = State::Allocate(SYM_UNION);
+    State* finite = State::Allocate();
+    finite->SetFinite();
+
+    //
+    // (node, symbol) -> child node
+    //
+
+    std::vector<State*> nodes = { initial };
+    std::unordered_map<uint64_t, size_t> children;
+
+    for (auto const& word : Words)
+    {
+        size_t node = 0;
+        for (auto sym : word)
+        {
+            auto key = (uint64_t(node) << 8) | uint8_t(sym);
+            auto found = children.find(key);
+            if (found == children.end())
+            {
+                found = children.emplace(key, nodes.size()).first;
+                nodes.push_back(State::Allocate(sym));
+                nodes[node]->Connect(nodes.back(), sym);
+            }
+
+            node = found->second;
+        }
+
+        nodes[node]->Connect(finite, Eps);
+    }
+
+    return Automaton(initial, finite);
+}
+
+
 Automaton ParseReversePolishRegexp(std::string Regexp, AlphabetType const& Aplhabet)
 {
     if (Regexp.empty())
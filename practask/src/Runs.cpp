@@ -0,0 +1,292 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Runs.cpp
+
+Abstract:
+
+    Run-length encoded words matching implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <Budget.h>
+#include <Runs.h>
+
+//
+// Definitions
+//
+
+RunLengthWord EncodeRuns(std::string_view Word)
+{
+    RunLengthWord runs;
+    for (auto sym : Word)
+    {
+        if (!runs.empty() && runs.back().Sym == sym)
+            runs.back().Length++;
+        else
+            runs.push_back({sym, 1});
+    }
+
+    return runs;
+}
+
+bool PreferRuns(std::string_view Word)
+{
+    if (Word.length() < RunsMinLength)
+        return false;
+
+    size_t maxRuns = Word.length() / RunsMinAverage;
+    size_t runs = 1;
+
+    for (size_t idx = 1; idx != Word.length(); idx++)
+        if (Word[idx] != Word[idx - 1] && ++runs > maxRuns)
+            return false;
+
+    return true;
+}
+
+// ******************************************************
+//                  Repetition powers
+// ******************************************************
+
+RunPowers::RunPowers(CompiledAutomaton const& Automaton) :
+    Automaton_(Automaton),
+    Seen_(Automaton.StatesCount(), NotSeen)
+{
+}
+
+RunPowers::Orbit const& RunPowers::Of(StateId From, char Sym)
+{
+    auto key = (uint64_t(uint8_t(Sym)) << 32) | From;
+    auto found = Orbits_.find(key);
+    if (found != Orbits_.end())
+        return found->second;
+
+    Orbit orbit;
+    auto state = From;
+
+    while (true)
+    {
+        if (state == CompiledAutomaton::Dead)
+        {
+            orbit.CycleBegin = orbit.Path.size();
+            orbit.Path.push_back(state);
+            break;
+        }
+
+        if (Seen_[state] != NotSeen)
+        {
+            orbit.CycleBegin = Seen_[state];
+            break;
+        }
+
+        Seen_[state] = orbit.Path.size();
+        orbit.Path.push_back(state);
+        state = Automaton_.Step(state, Sym);
+    }
+
+    for (auto member : orbit.Path)
+        if (member != CompiledAutomaton::Dead)
+            Seen_[member] = NotSeen;
+
+    Budget::Tick(orbit.Path.size());
+    return Orbits_.emplace(key, std::move(orbit)).first->second;
+}
+
+RunPowers::StateId RunPowers::After(StateId From, char Sym, size_t Repeats)
+{
+    auto const& orbit = Of(From, Sym);
+    if (Repeats < orbit.Path.size())
+        return orbit.Path[Repeats];
+
+    auto cycle = orbit.Path.size() - orbit.CycleBegin;
+    return orbit.Path[orbit.CycleBegin + (Repeats - orbit.CycleBegin) % cycle];
+}
+
+size_t RunPowers::LastFinite(StateId From, char Sym, size_t Repeats)
+{
+    size_t last = 0;
+
+    //
+    // Every index of the path stands for its largest repetitions count
+    //
+
+    ForEachLast(From, Sym, Repeats,
+        [this, &last](StateId State, size_t Count)
+        {
+            if (State != CompiledAutomaton::Dead && Automaton_.Finite(State))
+                last = std::max(last, Count);
+        });
+
+    return last;
+}
+
+// ******************************************************
+//                       Matching
+// ******************************************************
+
+class RunsMatcher
+{
+public:
+    static constexpr size_t NoMatch = SIZE_MAX;
+
+protected:
+    CompiledAutomaton const& Automaton_;
+    RunLengthWord const& Runs_;
+    RunPowers Powers_;
+
+    //
+    // (run, state) -> longest accepted extension from the state
+    // entering the run
+    //
+
+    std::unordered_map<uint64_t, size_t> Extensions_;
+
+public:
+    RunsMatcher(CompiledAutomaton const& Automaton, RunLengthWord const& Runs) :
+        Automaton_(Automaton),
+        Runs_(Runs),
+        Powers_(Automaton)
+    {
+    }
+
+    RunPowers& Powers()
+    {
+        return Powers_;
+    }
+
+    //
+    // Longest accepted nonempty word of the runs starting at Run,
+    // read from State, NoMatch if none
+    //
+
+    size_t Extension(size_t Run, RunPowers::StateId State)
+    {
+        auto key = [](size_t Run, RunPowers::StateId State) { return (uint64_t(Run) << 32) | State; };
+
+        std::vector<std::pair<size_t, RunPowers::StateId>> pending;
+        size_t extension = NoMatch;
+
+        while (Run != Runs_.size() && State != CompiledAutomaton::Dead)
+        {
+            auto found = Extensions_.find(key(Run, State));
+            if (found != Extensions_.end())
+            {
+                extension = found->second;
+                break;
+            }
+
+            pending.push_back({Run, State});
+            State = Powers_.After(State, Runs_[Run].Sym, Runs_[Run].Length);
+            Run++;
+        }
+
+        Budget::Tick(pending.size() + 1);
+
+        //
+        // Back from the last run: the whole run and then its extension,
+        // or the last accepting repetition within the run
+        //
+
+        for (auto current = pending.rbegin(); current != pending.rend(); current++)
+        {
+            auto const& run = Runs_[current->first];
+            if (extension != NoMatch)
+                extension += run.Length;
+            else if (auto last = Powers_.LastFinite(current->second, run.Sym, run.Length); last != 0)
+                extension = last;
+
+            Extensions_[key(current->first, current->second)] = extension;
+        }
+
+        return extension;
+    }
+};
+
+std::optional<MatchSpan> FindLongestMatch(CompiledAutomaton const& Automaton, RunLengthWord const& Runs, MatchStats* Stats)
+{
+    size_t length = 0;
+    for (auto const& run : Runs)
+        length += run.Length;
+
+    if (Automaton.MinLength() == CompiledAutomaton::Unbounded ||
+        Automaton.MinLength() > length)
+        return std::nullopt;
+
+    RunsMatcher matcher(Automaton, Runs);
+    auto maxLength = Automaton.MaxLength();
+
+    MatchSpan longest;
+    size_t maxAcceptedSubstrLen = 0;
+
+    auto offer = [&longest, &maxAcceptedSubstrLen](size_t Begin, size_t Length)
+    {
+        if (Length > maxAcceptedSubstrLen ||
+            (Length == maxAcceptedSubstrLen && Length != 0 && Begin < longest.Begin))
+        {
+            maxAcceptedSubstrLen = Length;
+            longest = { Begin, Begin + Length };
+        }
+    };
+
+    size_t runBegin = 0;
+    for (size_t idx = 0; idx != Runs.size(); runBegin += Runs[idx++].Length)
+    {
+        if (maxAcceptedSubstrLen >= length - runBegin || maxAcceptedSubstrLen == maxLength)
+            break;
+
+        auto const& run = Runs[idx];
+
+        //
+        // Within the run: the longest is the leftmost start
+        //
+
+        auto initial = Automaton.Initial();
+        offer(runBegin, matcher.Powers().LastFinite(initial, run.Sym, run.Length));
+
+        //
+        // Beyond the run: a start inside it is known by the state it
+        // leaves the run in
+        //
+
+        matcher.Powers().ForEachLast(initial, run.Sym, run.Length,
+            [&](RunPowers::StateId State, size_t Repeats)
+            {
+                if (State == CompiledAutomaton::Dead)
+                    return;
+
+                if (Stats != nullptr)
+                    Stats->Starts++;
+
+                auto extension = matcher.Extension(idx + 1, State);
+                if (extension != RunsMatcher::NoMatch)
+                    offer(runBegin + run.Length - Repeats, Repeats + extension);
+            });
+    }
+
+    if (maxAcceptedSubstrLen == 0 && !Automaton.Finite(Automaton.Initial()))
+        return std::nullopt;
+
+    return longest;
+}
+
+size_t SolveTask13(CompiledAutomaton const& Automaton, RunLengthWord const& Runs, MatchStats* Stats)
+{
+    auto longest = FindLongestMatch(Automaton, Runs, Stats);
+    return longest ? longest->Length() : 0;
+}
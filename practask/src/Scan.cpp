@@ -0,0 +1,205 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Scan.cpp
+
+Abstract:
+
+    Vectorized byte set search implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <cstring>
+#include <Scan.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//
+// SSSE3 is not in the x86-64 baseline, so the shuffle kernel is
+// compiled for it separately and chosen at run time
+//
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define SCAN_SHUFFLE
+#endif
+
+//
+// Definitions
+//
+
+size_t const MaxCompareBytes = 4;
+
+#if defined(SCAN_SHUFFLE)
+__attribute__((target("ssse3")))
+char const* FindShuffleSsse3(uint8_t const* LowNibbles, uint8_t const* HighNibbles, char const* Begin, char const* End)
+{
+    auto lowTable = _mm_loadu_si128(reinterpret_cast<__m128i const*>(LowNibbles));
+    auto highTable = _mm_loadu_si128(reinterpret_cast<__m128i const*>(HighNibbles));
+    auto nibbleMask = _mm_set1_epi8(0x0F);
+    auto zero = _mm_setzero_si128();
+
+    auto position = Begin;
+    for (; End - position >= 16; position += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(position));
+        auto low = _mm_and_si128(block, nibbleMask);
+        auto high = _mm_and_si128(_mm_srli_epi16(block, 4), nibbleMask);
+
+        auto classes = _mm_and_si128(
+            _mm_shuffle_epi8(lowTable, low),
+            _mm_shuffle_epi8(highTable, high));
+
+        auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(classes, zero)) ^ 0xFFFF;
+        if (mask != 0)
+            return position + __builtin_ctz(unsigned(mask));
+    }
+
+    //
+    // Tail shorter than a block is left to the caller
+    //
+
+    return position;
+}
+#endif
+
+bool ByteScanner::HasShuffle()
+{
+#if defined(SCAN_SHUFFLE)
+    static bool const supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+ByteScanner::ByteScanner(std::string_view Bytes)
+{
+    for (auto sym : Bytes)
+    {
+        if (Member_[uint8_t(sym)])
+            continue;
+
+        Member_[uint8_t(sym)] = 1;
+        Bytes_ += sym;
+    }
+
+    //
+    // Every distinct high nibble gets its own bit, so that
+    // Low[lo] & High[hi] is exact
+    //
+
+    std::array<uint8_t, 16> highBits = {};
+    size_t bitsUsed = 0;
+
+    for (auto sym : Bytes_)
+    {
+        auto high = uint8_t(sym) >> 4;
+        if (highBits[high] == 0)
+        {
+            if (bitsUsed == 8)
+                return;
+
+            highBits[high] = uint8_t(1 << bitsUsed++);
+        }
+
+        HighNibbles_[high] = highBits[high];
+        LowNibbles_[uint8_t(sym) & 0xF] |= highBits[high];
+    }
+
+    Shuffle_ = true;
+}
+
+
+char const* ByteScanner::Find(char const* Begin, char const* End) const
+{
+    if (Bytes_.empty() || Begin == End)
+        return End;
+
+    if (Bytes_.size() == 1)
+    {
+        auto found = memchr(Begin, Bytes_[0], size_t(End - Begin));
+        return found ? static_cast<char const*>(found) : End;
+    }
+
+    if (Shuffle_ && Bytes_.size() > MaxCompareBytes && HasShuffle())
+        return FindShuffle(Begin, End);
+
+#if defined(__SSE2__)
+    if (Bytes_.size() <= MaxCompareBytes)
+        return FindCompare(Begin, End);
+#endif
+
+    return FindScalar(Begin, End);
+}
+
+
+char const* ByteScanner::FindScalar(char const* Begin, char const* End) const
+{
+    for (auto position = Begin; position != End; position++)
+        if (Member_[uint8_t(*position)])
+            return position;
+
+    return End;
+}
+
+
+char const* ByteScanner::FindCompare(char const* Begin, char const* End) const
+{
+#if defined(__SSE2__)
+    __m128i needles[MaxCompareBytes];
+    for (size_t idx = 0; idx != Bytes_.size(); idx++)
+        needles[idx] = _mm_set1_epi8(Bytes_[idx]);
+
+    auto position = Begin;
+    for (; End - position >= 16; position += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(position));
+        auto hits = _mm_cmpeq_epi8(block, needles[0]);
+
+        for (size_t idx = 1; idx != Bytes_.size(); idx++)
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[idx]));
+
+        auto mask = _mm_movemask_epi8(hits);
+        if (mask != 0)
+            return position + __builtin_ctz(unsigned(mask));
+    }
+
+    return FindScalar(position, End);
+#else
+    return FindScalar(Begin, End);
+#endif
+}
+
+
+char const* ByteScanner::FindShuffle(char const* Begin, char const* End) const
+{
+#if defined(SCAN_SHUFFLE)
+    if (!Shuffle_ || !HasShuffle())
+        return FindScalar(Begin, End);
+
+    auto position = FindShuffleSsse3(LowNibbles_.data(), HighNibbles_.data(), Begin, End);
+    if (End - position >= 16)
+        return position;
+
+    return FindScalar(position, End);
+#else
+    return FindScalar(Begin, End);
+#endif
+}
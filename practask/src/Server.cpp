@@ -0,0 +1,428 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Server.cpp
+
+Abstract:
+
+    regsolver server implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Planner.h>
+#include <Server.h>
+#include <Task.h>
+
+//
+// Definitions
+//
+
+Server::Server(std::string Path, ThreadPool& Pool, Limits const& QueryLimits, size_t CacheCapacity) :
+    Path_(std::move(Path)),
+    Pool_(Pool),
+    QueryLimits_(QueryLimits),
+    Cache_(CacheCapacity)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (Path_.length() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path is too long");
+
+    strcpy(address.sun_path, Path_.c_str());
+    unlink(Path_.c_str());
+
+    Listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Listener_ < 0)
+        throw std::runtime_error(std::string("socket: ") + strerror(errno));
+
+    if (bind(Listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(Listener_, SOMAXCONN) < 0)
+    {
+        auto error = std::runtime_error(std::string("bind: ") + strerror(errno));
+        close(Listener_);
+        throw error;
+    }
+
+    if (pipe2(WakePipe_, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        auto error = std::runtime_error(std::string("pipe: ") + strerror(errno));
+        close(Listener_);
+        throw error;
+    }
+}
+
+
+Server::~Server()
+{
+    Stop();
+    CloseConnections();
+
+    //
+    // Requests still queued in the pool refer to this
+    //
+
+    std::unique_lock<std::mutex> lock(ConnectionsMutex_);
+    NoConnections_.wait(lock, [this]() { return Connections_.empty(); });
+
+    close(Listener_);
+    close(WakePipe_[0]);
+    close(WakePipe_[1]);
+    unlink(Path_.c_str());
+}
+
+
+void Server::Serve()
+{
+    {
+        std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+        Serving_ = true;
+    }
+
+    std::vector<pollfd> polled;
+    std::string error;
+
+    while (!Stopping_)
+    {
+        Dispatch(polled);
+
+        if (poll(polled.data(), polled.size(), PollTimeout()) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            error = std::string("poll: ") + strerror(errno);
+            break;
+        }
+
+        if (Stopping_)
+            break;
+
+        if (polled[0].revents != 0)
+        {
+            char drained[64];
+            while (read(WakePipe_[0], drained, sizeof(drained)) > 0)
+                ;
+        }
+
+        try
+        {
+            if (polled[1].revents != 0)
+                Accept();
+        }
+
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+        for (size_t idx = 2; idx != polled.size(); idx++)
+        {
+            if (polled[idx].revents != 0)
+                Receive(polled[idx].fd, Connections_.at(polled[idx].fd));
+        }
+    }
+
+    //
+    // Connections being answered are closed by their workers
+    //
+
+    {
+        std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+        Serving_ = false;
+
+        for (auto connectionIt = Connections_.begin(); connectionIt != Connections_.end();)
+        {
+            auto fd = connectionIt->first;
+            shutdown(fd, SHUT_RDWR);
+
+            if (connectionIt++->second.Busy)
+                continue;
+
+            CloseConnection(fd);
+        }
+    }
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+
+void Server::Stop()
+{
+    //
+    // Wakes up poll() in Serve()
+    //
+
+    if (!Stopping_.exchange(true))
+    {
+        auto savedErrno = errno;
+        shutdown(Listener_, SHUT_RDWR);
+        Wake();
+        errno = savedErrno;
+    }
+}
+
+
+void Server::Wake()
+{
+    //
+    // Full pipe wakes poll() up as well
+    //
+
+    char byte = 0;
+    while (write(WakePipe_[1], &byte, 1) < 0 && errno == EINTR)
+        ;
+}
+
+
+void Server::CloseConnections()
+{
+    //
+    // Makes workers blocked in WriteFrame() fail
+    //
+
+    std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+    for (auto const& connection : Connections_)
+        shutdown(connection.first, SHUT_RDWR);
+}
+
+
+void Server::CloseConnection(int Fd)
+{
+    //
+    // ConnectionsMutex_ is held
+    //
+
+    close(Fd);
+    Connections_.erase(Fd);
+
+    if (Connections_.empty())
+        NoConnections_.notify_all();
+}
+
+
+void Server::Accept()
+{
+    int fd = accept(Listener_, nullptr, nullptr);
+    if (fd < 0)
+    {
+        if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED ||
+            errno == EINVAL || Stopping_)
+            return;
+
+        if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+        {
+            DEBUG_OUT("accept: %s", strerror(errno));
+            AcceptPausedUntil_ = std::chrono::steady_clock::now() + AcceptPause;
+            return;
+        }
+
+        throw std::runtime_error(std::string("accept: ") + strerror(errno));
+    }
+
+    std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+    Connections_[fd];
+}
+
+
+int Server::PollTimeout() const
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now >= AcceptPausedUntil_)
+        return -1;
+
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(AcceptPausedUntil_ - now).count()) + 1;
+}
+
+
+void Server::Receive(int Fd, Connection& Client)
+{
+    //
+    // poll() reported the socket readable, so recv() does not block
+    //
+
+    char buffer[4096];
+    auto got = recv(Fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+    if (got > 0)
+        Client.Input.append(buffer, size_t(got));
+
+    else if (got == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+        Client.Closing = true;
+}
+
+
+void Server::Dispatch(std::vector<pollfd>& Polled)
+{
+    Polled.clear();
+    Polled.push_back({ WakePipe_[0], POLLIN, 0 });
+
+    //
+    // Negative fd is ignored by poll()
+    //
+
+    auto paused = std::chrono::steady_clock::now() < AcceptPausedUntil_;
+    Polled.push_back({ paused ? -1 : Listener_, POLLIN, 0 });
+
+    std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+    for (auto connectionIt = Connections_.begin(); connectionIt != Connections_.end();)
+    {
+        auto fd = connectionIt->first;
+        auto& connection = connectionIt++->second;
+
+        //
+        // Next request of the connection waits for the answer
+        //
+
+        if (connection.Busy)
+            continue;
+
+        std::string request;
+        bool ready = false;
+
+        try
+        {
+            ready = TakeFrame(connection.Input, request);
+        }
+
+        catch (const std::exception& e)
+        {
+            DEBUG_OUT("%s", e.what());
+            connection.Closing = true;
+        }
+
+        if (ready)
+        {
+            connection.Busy = true;
+            Pool_.Submit([this, fd, request = std::move(request)]() { ServeRequest(fd, request); });
+        }
+
+        else if (connection.Closing)
+            CloseConnection(fd);
+
+        else
+            Polled.push_back({ fd, POLLIN, 0 });
+    }
+}
+
+
+void Server::ServeRequest(int Fd, std::string const& Request)
+{
+    bool broken = false;
+
+    try
+    {
+        WriteFrame(Fd, Respond(Request));
+    }
+
+    catch (const std::exception& e)
+    {
+        //
+        // Broken connection, nothing to answer to
+        //
+
+        DEBUG_OUT("%s", e.what());
+        broken = true;
+    }
+
+    std::lock_guard<std::mutex> lock(ConnectionsMutex_);
+    auto& connection = Connections_.at(Fd);
+    connection.Busy = false;
+    connection.Closing |= broken;
+
+    if (Serving_)
+        Wake();
+    else
+        CloseConnection(Fd);
+}
+
+
+std::string Server::Respond(std::string const& Request)
+{
+    if (Request.length() == 1 && Request[0] == REQUEST_STATS)
+        return std::string(1, char(RESPONSE_OK)) + StatsReport();
+
+    auto start = std::chrono::steady_clock::now();
+    std::string response;
+
+    try
+    {
+        auto query = DecodeQuery(Request);
+        AlphabetType alphabet(query.Alphabet.begin(), query.Alphabet.end());
+
+        CheckWord(query.Word, alphabet);
+        Budget budget(QueryLimits_);
+        QueryPlan plan;
+        response = EncodeAnswer(SolvePlanned(query.Regexp, query.Word, alphabet, &Cache_, &plan));
+
+        Stats_.Engines[size_t(plan.Chosen)]++;
+        Stats_.Fallbacks += plan.FellBack;
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        Stats_.OverBudget++;
+        response = EncodeBudgetExceeded(e.Exhausted());
+    }
+
+    catch (const std::exception& e)
+    {
+        Stats_.Errors++;
+        response = std::string(1, char(RESPONSE_ERROR)) + e.what();
+    }
+
+    Stats_.Requests++;
+    Stats_.Latency.Record(std::chrono::steady_clock::now() - start);
+    return response;
+}
+
+
+std::string Server::StatsReport()
+{
+    std::ostringstream report;
+
+    auto hits = Cache_.Hits();
+    auto misses = Cache_.Misses();
+    auto lookups = hits + misses;
+
+    report << "requests " << Stats_.Requests << "\n";
+    report << "errors " << Stats_.Errors << "\n";
+    report << "budget_exceeded " << Stats_.OverBudget << "\n";
+    report << "fallbacks " << Stats_.Fallbacks << "\n";
+    report << "workers " << Pool_.Size() << "\n";
+    report << "cache_hits " << hits << "\n";
+    report << "cache_misses " << misses << "\n";
+    report << "cache_size " << Cache_.Size() << "\n";
+    report << "cache_hit_rate " << (lookups ? double(hits) / double(lookups) : 0.0) << "\n";
+
+    for (size_t engine = 0; engine != EnginesCount; engine++)
+        report << "engine_" << EngineName(Engine(engine)) << " " << Stats_.Engines[engine] << "\n";
+
+    Stats_.Latency.Report(report);
+
+    return report.str();
+}
@@ -0,0 +1,122 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Session.cpp
+
+Abstract:
+
+    Incremental matching session implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <Budget.h>
+#include <Session.h>
+
+//
+// Definitions
+//
+
+MatchSession::MatchSession(CompiledAutomaton const& Automaton) :
+    Automaton_(Automaton),
+    Start_(Automaton.StatesCount(), NoStart),
+    NextStart_(Automaton.StatesCount(), NoStart),
+    Matched_(Automaton.Finite(Automaton.Initial()))
+{
+    Live_.reserve(Automaton.StatesCount());
+    NextLive_.reserve(Automaton.StatesCount());
+}
+
+
+size_t MatchSession::Step(char Sym)
+{
+    auto initial = Automaton_.Initial();
+    if (Start_[initial] == NoStart)
+    {
+        Start_[initial] = Position_;
+        Live_.push_back(initial);
+    }
+
+    for (auto state : Live_)
+    {
+        auto to = Automaton_.Step(state, Sym);
+        auto start = Start_[state];
+        Start_[state] = NoStart;
+
+        if (to == CompiledAutomaton::Dead)
+            continue;
+
+        if (NextStart_[to] == NoStart)
+        {
+            NextStart_[to] = start;
+            NextLive_.push_back(to);
+        }
+
+        else
+            NextStart_[to] = std::min(NextStart_[to], start);
+    }
+
+    Live_.swap(NextLive_);
+    NextLive_.clear();
+    Start_.swap(NextStart_);
+    Position_++;
+
+    auto begin = NoStart;
+    for (auto state : Live_)
+    {
+        if (Automaton_.Finite(state))
+            begin = std::min(begin, Start_[state]);
+    }
+
+    //
+    // Strictly longer only, so the leftmost one is kept
+    //
+
+    if (begin != NoStart && Position_ - begin > Longest_)
+    {
+        Longest_ = Position_ - begin;
+        LongestBegin_ = begin;
+        Matched_ = true;
+    }
+
+    if (begin == NoStart && Automaton_.Finite(initial))
+        begin = Position_;
+
+    return begin;
+}
+
+
+void MatchSession::Append(std::string_view Chunk)
+{
+    Budget::Tick(Chunk.length());
+
+    for (auto sym : Chunk)
+        Step(sym);
+}
+
+
+void MatchSession::Reset()
+{
+    for (auto state : Live_)
+        Start_[state] = NoStart;
+
+    Live_.clear();
+    Position_ = 0;
+    Longest_ = 0;
+    LongestBegin_ = 0;
+    Matched_ = Automaton_.Finite(Automaton_.Initial());
+}
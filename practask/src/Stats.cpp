@@ -0,0 +1,88 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Stats.cpp
+
+Abstract:
+
+    Statistics counters implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Stats.h>
+
+//
+// Definitions
+//
+
+void LatencyHistogram::Record(std::chrono::nanoseconds Latency)
+{
+    auto us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(Latency).count());
+
+    size_t bucket = 0;
+    while (us != 0 && bucket != Buckets - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    Counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+uint64_t LatencyHistogram::Total() const
+{
+    uint64_t total = 0;
+    for (auto const& count : Counts_)
+        total += count.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+
+uint64_t LatencyHistogram::QuantileUs(double Quantile) const
+{
+    auto total = Total();
+    if (total == 0)
+        return 0;
+
+    auto rank = uint64_t(Quantile * double(total - 1)) + 1;
+    uint64_t seen = 0;
+
+    for (size_t bucket = 0; bucket != Buckets; bucket++)
+    {
+        seen += Counts_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return uint64_t(1) << bucket;
+    }
+
+    return uint64_t(1) << (Buckets - 1);
+}
+
+
+void LatencyHistogram::Report(std::ostream& Stream) const
+{
+    Stream << "latency_p50_us " << QuantileUs(0.5) << "\n";
+    Stream << "latency_p99_us " << QuantileUs(0.99) << "\n";
+
+    for (size_t bucket = 0; bucket != Buckets; bucket++)
+    {
+        auto count = Counts_[bucket].load(std::memory_order_relaxed);
+        if (count != 0)
+            Stream << "latency_us[<" << (uint64_t(1) << bucket) << "] " << count << "\n";
+    }
+}
@@ -0,0 +1,196 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Tables.cpp
+
+Abstract:
+
+    Alternative transition table layouts implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <Tables.h>
+
+//
+// Definitions
+//
+
+template <typename Id>
+void CheckFits(CompiledAutomaton const& Automaton)
+{
+    if (Automaton.StatesCount() >= std::numeric_limits<Id>::max())
+        throw std::runtime_error(
+            "Too many states for " + std::to_string(sizeof(Id) * 8) +
+            "-bit state ids (" + std::to_string(Automaton.StatesCount()) + ")");
+}
+
+template <typename Id>
+Id Narrow(CompiledAutomaton::StateId State)
+{
+    return (State == CompiledAutomaton::Dead) ? std::numeric_limits<Id>::max() : Id(State);
+}
+
+// ******************************************************
+//                     Dense table
+// ******************************************************
+
+template <typename Id>
+DenseTable<Id> DenseTable<Id>::FromCompiled(CompiledAutomaton const& Automaton)
+{
+    CheckFits<Id>(Automaton);
+
+    DenseTable table;
+    table.Columns_.fill(-1);
+    table.AlphabetSize_ = Automaton.AlphabetSize();
+    table.MinLength_ = Automaton.MinLength();
+    table.MaxLength_ = Automaton.MaxLength();
+
+    auto const& symbols = Automaton.Symbols();
+    for (size_t column = 0; column != symbols.size(); column++)
+        table.Columns_[uint8_t(symbols[column])] = int16_t(column);
+
+    table.Table_.reserve(Automaton.StatesCount() * symbols.size());
+    for (CompiledAutomaton::StateId state = 0; state != Automaton.StatesCount(); state++)
+    {
+        table.Finite_.push_back(Automaton.Finite(state));
+        for (auto sym : symbols)
+            table.Table_.push_back(Narrow<Id>(Automaton.Step(state, sym)));
+    }
+
+    return table;
+}
+
+// ******************************************************
+//                     Comb vector
+// ******************************************************
+
+template <typename Id>
+CombTable<Id> CombTable<Id>::FromCompiled(CompiledAutomaton const& Automaton)
+{
+    CheckFits<Id>(Automaton);
+
+    auto statesCount = Automaton.StatesCount();
+    auto const& symbols = Automaton.Symbols();
+
+    CombTable table;
+    table.Columns_.fill(-1);
+    table.MinLength_ = Automaton.MinLength();
+    table.MaxLength_ = Automaton.MaxLength();
+
+    for (size_t column = 0; column != symbols.size(); column++)
+        table.Columns_[uint8_t(symbols[column])] = int16_t(column);
+
+    //
+    // Default is the most frequent target of the row (Dead usually),
+    // only the other columns are packed
+    //
+
+    std::vector<std::vector<std::pair<size_t, Id>>> rows(statesCount);
+    table.Rows_.resize(statesCount);
+
+    for (CompiledAutomaton::StateId state = 0; state != statesCount; state++)
+    {
+        table.Finite_.push_back(Automaton.Finite(state));
+
+        std::map<Id, size_t> frequency;
+        for (auto sym : symbols)
+            frequency[Narrow<Id>(Automaton.Step(state, sym))]++;
+
+        auto most = std::max_element(frequency.begin(), frequency.end(),
+            [](auto const& First, auto const& Second) { return First.second < Second.second; });
+
+        auto fallback = most->first;
+        table.Rows_[state].Default = fallback;
+
+        for (size_t column = 0; column != symbols.size(); column++)
+        {
+            auto to = Narrow<Id>(Automaton.Step(state, symbols[column]));
+            if (to != fallback)
+                rows[state].push_back({column, to});
+        }
+    }
+
+    //
+    // First fit, fullest rows first: they are the hardest to place
+    //
+
+    std::vector<CompiledAutomaton::StateId> order(statesCount);
+    for (CompiledAutomaton::StateId state = 0; state != statesCount; state++)
+        order[state] = state;
+
+    std::stable_sort(order.begin(), order.end(),
+        [&rows](auto First, auto Second) { return rows[First].size() > rows[Second].size(); });
+
+    std::vector<uint8_t> baseUsed;
+    size_t firstFree = 0;
+
+    for (auto state : order)
+    {
+        auto const& row = rows[state];
+
+        //
+        // Two rows may not share a base: an empty slot of one would
+        // be checked as the other's
+        //
+
+        size_t base = row.empty() ? 0 : (firstFree > row.front().first ? firstFree - row.front().first : 0);
+        while (true)
+        {
+            if (base >= baseUsed.size())
+                baseUsed.resize(base + 1, 0);
+
+            bool fits = !baseUsed[base];
+            for (size_t idx = 0; fits && idx != row.size(); idx++)
+            {
+                auto slot = base + row[idx].first;
+                fits = slot >= table.Slots_.size() || table.Slots_[slot].Check == Dead;
+            }
+
+            if (fits)
+                break;
+
+            base++;
+        }
+
+        baseUsed[base] = 1;
+        table.Rows_[state].Base = uint32_t(base);
+
+        //
+        // Any column may be looked up, so the vector covers the whole row
+        //
+
+        if (table.Slots_.size() < base + symbols.size())
+            table.Slots_.resize(base + symbols.size(), Slot{Dead, Dead});
+
+        for (auto const& [column, to] : row)
+            table.Slots_[base + column] = Slot{to, Id(state)};
+
+        while (firstFree < table.Slots_.size() && table.Slots_[firstFree].Check != Dead)
+            firstFree++;
+    }
+
+    return table;
+}
+
+template class DenseTable<uint16_t>;
+template class DenseTable<uint32_t>;
+template class CombTable<uint16_t>;
+template class CombTable<uint32_t>;
@@ -23,40 +23,171 @@ Revision History:
 // Includes / usings
 //
 
+#include <limits>
+#include <stdexcept>
+#include <Budget.h>
 #include <Regexp.h>
 #include <Optimize.h>
+#include <Runs.h>
+#include <Task.h>
 
 //
 // Definitions
 //
 
-size_t TryAcceptTask13(Automaton automaton, std::string::const_iterator begin, std::string::const_iterator end)
+void CheckWord(std::string_view Word, AlphabetType const& Alphabet)
 {
-    assert(automaton.IsValid());
+    for (size_t idx = 0; idx != Word.length(); idx++)
+        if (Alphabet.find(Word[idx]) == Alphabet.end())
+            throw std::runtime_error(
+                "Invalid symbol \'" +
+                std::string(1, Word[idx]) +
+                "\' (word_idx = " +
+                std::to_string(idx) + ")");
+}
+
+//
+// Stops the moment current state is Dead: after TrimDeadStates
+// it means that no longer prefix can be accepted
+//
+
+template <typename Id>
+size_t TryAccept(CompiledAutomaton const& Automaton, char const* Begin, char const* End, MatchStats* Stats)
+{
+    auto table = Automaton.template Table<Id>();
+    auto alphabetSize = Automaton.AlphabetSize();
+    auto dead = std::numeric_limits<Id>::max();
 
-    size_t stepped = 0;
     size_t maxAcceptedPrefixLen = 0;
-    State* current = automaton.Initial;
-    
-    for (auto& position = begin; position != end; position++)
+    size_t current = Automaton.Initial();
+    auto position = Begin;
+
+    for (; position != End; position++)
     {
-        auto to = current->To(*position);
-        if (to == nullptr)
-            return maxAcceptedPrefixLen;
-        
-        stepped++;        
-        current = to;
-        
-        if (current->Finite())
-            maxAcceptedPrefixLen = stepped;
+        auto column = Automaton.Column(*position);
+        if (column < 0)
+            break;
+
+        auto next = table[current * alphabetSize + size_t(column)];
+        if (next == dead)
+            break;
+
+        current = next;
+        if (Automaton.Finite(CompiledAutomaton::StateId(current)))
+            maxAcceptedPrefixLen = size_t(position - Begin) + 1;
     }
 
+    if (Stats != nullptr)
+        Stats->SymbolsStepped += size_t(position - Begin) + (position != End);
+
+    Budget::Tick(size_t(position - Begin) + 1);
+
     return maxAcceptedPrefixLen;
 }
 
+size_t TryAcceptTask13(CompiledAutomaton const& Automaton, char const* Begin, char const* End, MatchStats* Stats)
+{
+    if (Automaton.IsNarrow())
+        return TryAccept<CompiledAutomaton::NarrowId>(Automaton, Begin, End, Stats);
+
+    return TryAccept<CompiledAutomaton::StateId>(Automaton, Begin, End, Stats);
+}
+
+//
+// Skips positions no nonempty accepted substring can start at
+//
+
+char const* NextCandidate(CompiledAutomaton const& Automaton, char const* Begin, char const* End)
+{
+    auto const& prefix = Automaton.RequiredPrefix();
+    if (prefix.length() < 2)
+        return Automaton.FirstSymbols().Find(Begin, End);
+
+    auto found = std::string_view(Begin, size_t(End - Begin)).find(prefix);
+    return (found == std::string_view::npos) ? End : Begin + found;
+}
+
+std::optional<MatchSpan> FindLongestMatch(CompiledAutomaton const& Automaton, std::string_view Word, MatchStats* Stats)
+{
+    MatchSpan longest;
+    size_t maxAcceptedSubstrLen = 0;
+    auto end = Word.data() + Word.length();
+
+    //
+    // Only the empty word (if any) fits into a too short word
+    //
+
+    if (Automaton.MinLength() == CompiledAutomaton::Unbounded ||
+        Automaton.MinLength() > Word.length())
+        return std::nullopt;
+
+    //
+    // Long runs are not stepped symbol by symbol
+    //
+
+    if (PreferRuns(Word))
+        return FindLongestMatch(Automaton, EncodeRuns(Word), Stats);
+
+    auto maxLength = Automaton.MaxLength();
+
+    bool prefilter = Automaton.FirstSymbols().Bytes().size() < Automaton.AlphabetSize() ||
+                     Automaton.RequiredPrefix().length() > 1;
+
+    for (auto current = Word.data(); current != end; current++)
+    {
+        if (prefilter)
+        {
+            current = NextCandidate(Automaton, current, end);
+            if (current == end)
+                break;
+        }
+
+        if (maxAcceptedSubstrLen >= size_t(end - current))
+            break;
+
+        if (Stats != nullptr)
+            Stats->Starts++;
+
+        //
+        // Only a strictly longer one replaces the leftmost
+        //
+
+        auto window = std::min(size_t(end - current), maxLength);
+        auto accepted = TryAcceptTask13(Automaton, current, current + window, Stats);
+
+        if (accepted > maxAcceptedSubstrLen)
+        {
+            maxAcceptedSubstrLen = accepted;
+            longest.Begin = size_t(current - Word.data());
+            longest.End = longest.Begin + accepted;
+        }
+
+        if (maxAcceptedSubstrLen == maxLength)
+            break;
+    }
+
+    //
+    // Nothing nonempty: the empty word at 0, if accepted
+    //
+
+    if (maxAcceptedSubstrLen == 0 && !Automaton.Finite(Automaton.Initial()))
+        return std::nullopt;
+
+    return longest;
+}
+
+
+size_t SolveTask13(CompiledAutomaton const& Automaton, std::string_view Word, MatchStats* Stats)
+{
+    auto longest = FindLongestMatch(Automaton, Word, Stats);
+    return longest ? longest->Length() : 0;
+}
+
 size_t SolveTask13(std::string const& ReversePolishRegexp, std::string const& Word, AlphabetType const& Alphabet, bool Debug)
 {
     Automaton::StartUsing();
+    if (Debug)
+        State::TrackProvenance();
 
     auto automaton = ParseReversePolishRegexp(ReversePolishRegexp, Alphabet);
     assert(automaton.IsValid());    
@@ -64,28 +195,29 @@ size_t SolveTask13(std::string const& ReversePolishRegexp, std::string const& Wo
         DebugAutomaton(automaton, "regexp");
 
     automaton = RemoveEpsilonTransitions(automaton);
+    automaton = CompactStates(automaton);
     assert(automaton.IsValid());
     if (Debug)
         DebugAutomaton(automaton, "epsremoved");
 
+    automaton = CompactStates(ReduceBisimilar(automaton));
+    assert(automaton.IsValid());
+    if (Debug)
+        DebugAutomaton(automaton, "reduced");
+
     automaton = NdfsmToDfsm(automaton, Alphabet);
+    automaton = CompactStates(automaton);
     assert(automaton.IsValid());
     if (Debug)
         DebugAutomaton(automaton, "dfsm");
 
-    size_t maxAcceptedSubstrLen = 0;
-    size_t symbolsLeft = Word.length();
+    automaton = RemoveUselessStates(automaton);
+    assert(automaton.IsValid());
+    if (Debug)
+        DebugAutomaton(automaton, "trimmed");
 
-    for (auto current = Word.cbegin(); current != Word.cend(); current++, symbolsLeft--)
-    {
-        if (maxAcceptedSubstrLen >= symbolsLeft)
-            break;
-        
-        maxAcceptedSubstrLen = std::max(maxAcceptedSubstrLen, 
-            TryAcceptTask13(automaton, current, Word.cend()));
-    }
-    
+    auto compiled = CompiledAutomaton::FromDfsm(automaton, Alphabet);
     Automaton::EndUsing();
 
-    return maxAcceptedSubstrLen;
+    return SolveTask13(compiled, Word);
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    ThreadPool.cpp
+
+Abstract:
+
+    Fixed-size thread pool implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <ThreadPool.h>
+
+//
+// Definitions
+//
+
+ThreadPool::ThreadPool(size_t Threads)
+{
+    if (Threads == 0)
+        Threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t idx = 0; idx != Threads; idx++)
+        Workers_.emplace_back(&ThreadPool::Work, this);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Stopping_ = true;
+    }
+
+    HasTasks_.notify_all();
+    for (auto& worker : Workers_)
+        worker.join();
+}
+
+
+void ThreadPool::Push(std::function<void()> Task)
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Tasks_.push(std::move(Task));
+    }
+
+    HasTasks_.notify_one();
+}
+
+
+void ThreadPool::Work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(Mutex_);
+            HasTasks_.wait(lock, [this]() { return Stopping_ || !Tasks_.empty(); });
+
+            //
+            // Queue is drained before stopping
+            //
+
+            if (Tasks_.empty())
+                return;
+
+            task = std::move(Tasks_.front());
+            Tasks_.pop();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,220 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    WordIndex.cpp
+
+Abstract:
+
+    Suffix automaton implementation.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <Budget.h>
+#include <WordIndex.h>
+
+//
+// Definitions
+//
+
+//
+// Online construction (Blumer et al.): appending a symbol adds one
+// state and at most one clone
+//
+
+WordIndex::WordIndex(std::string_view Word) :
+    WordLength_(Word.length())
+{
+    using Edges = std::vector<std::pair<char, StateId>>;
+
+    struct Node
+    {
+        size_t Length = 0;
+        int64_t Link = -1;
+        Edges Next;
+    };
+
+    auto find = [](auto& Next, char Sym)
+    {
+        return std::lower_bound(Next.begin(), Next.end(), Sym,
+            [](std::pair<char, StateId> const& Edge, char Sym) { return Edge.first < Sym; });
+    };
+
+    std::vector<Node> nodes(1);
+    nodes.reserve(2 * Word.length() + 1);
+    StateId last = Root;
+
+    for (auto sym : Word)
+    {
+        auto current = StateId(nodes.size());
+        nodes.push_back({nodes[last].Length + 1, -1, {}});
+        Budget::Tick();
+
+        int64_t state = last;
+        for (; state != -1; state = nodes[state].Link)
+        {
+            auto edge = find(nodes[state].Next, sym);
+            if (edge != nodes[state].Next.end() && edge->first == sym)
+                break;
+
+            nodes[state].Next.insert(edge, {sym, current});
+        }
+
+        if (state == -1)
+            nodes[current].Link = Root;
+
+        else
+        {
+            auto next = find(nodes[state].Next, sym)->second;
+
+            if (nodes[state].Length + 1 == nodes[next].Length)
+                nodes[current].Link = next;
+
+            else
+            {
+                auto clone = StateId(nodes.size());
+                nodes.push_back({nodes[state].Length + 1, nodes[next].Link, nodes[next].Next});
+
+                for (; state != -1; state = nodes[state].Link)
+                {
+                    auto edge = find(nodes[state].Next, sym);
+                    if (edge == nodes[state].Next.end() || edge->second != next)
+                        break;
+
+                    edge->second = clone;
+                }
+
+                nodes[next].Link = clone;
+                nodes[current].Link = clone;
+            }
+        }
+
+        last = current;
+    }
+
+    //
+    // Suffix links are not needed for queries
+    //
+
+    Offsets_.reserve(nodes.size() + 1);
+    for (auto const& node : nodes)
+    {
+        Offsets_.push_back(uint32_t(EdgeTargets_.size()));
+        for (auto const& [sym, to] : node.Next)
+        {
+            EdgeSymbols_.push_back(sym);
+            EdgeTargets_.push_back(to);
+        }
+    }
+
+    Offsets_.push_back(uint32_t(EdgeTargets_.size()));
+}
+
+
+bool WordIndex::Contains(std::string_view Substring) const
+{
+    auto state = Root;
+
+    for (auto sym : Substring)
+    {
+        auto begin = EdgeSymbols_.begin() + Offsets_[state];
+        auto end = EdgeSymbols_.begin() + Offsets_[state + 1];
+        auto edge = std::lower_bound(begin, end, sym);
+
+        if (edge == end || *edge != sym)
+            return false;
+
+        state = EdgeTargets_[size_t(edge - EdgeSymbols_.begin())];
+    }
+
+    return true;
+}
+
+
+//
+// Depth-first over the product, Best of a pair is the longest
+// continuation to a finite DFSM state (-1 if there is none)
+//
+
+size_t WordIndex::Solve(CompiledAutomaton const& Automaton) const
+{
+    using DfsmState = CompiledAutomaton::StateId;
+
+    if (Automaton.MinLength() == CompiledAutomaton::Unbounded ||
+        Automaton.MinLength() > WordLength_)
+        return 0;
+
+    struct Frame
+    {
+        StateId Index;
+        DfsmState Dfsm;
+        uint32_t Edge;
+        int64_t Best;
+    };
+
+    auto key = [](StateId Index, DfsmState Dfsm)
+    {
+        return (uint64_t(Index) << 32) | Dfsm;
+    };
+
+    std::unordered_map<uint64_t, int64_t> best;
+    std::vector<Frame> stack;
+
+    auto initial = Automaton.Initial();
+    stack.push_back({Root, initial, Offsets_[Root], Automaton.Finite(initial) ? 0 : -1});
+
+    while (true)
+    {
+        auto& frame = stack.back();
+
+        if (frame.Edge == Offsets_[frame.Index + 1])
+        {
+            auto done = frame;
+            best.emplace(key(done.Index, done.Dfsm), done.Best);
+            stack.pop_back();
+
+            if (stack.empty())
+                return size_t(std::max<int64_t>(done.Best, 0));
+
+            if (done.Best >= 0)
+                stack.back().Best = std::max(stack.back().Best, done.Best + 1);
+
+            continue;
+        }
+
+        auto edge = frame.Edge++;
+        auto to = Automaton.Step(frame.Dfsm, EdgeSymbols_[edge]);
+        if (to == CompiledAutomaton::Dead)
+            continue;
+
+        auto index = EdgeTargets_[edge];
+        auto found = best.find(key(index, to));
+
+        if (found != best.end())
+        {
+            if (found->second >= 0)
+                frame.Best = std::max(frame.Best, found->second + 1);
+
+            continue;
+        }
+
+        Budget::Tick();
+        stack.push_back({index, to, Offsets_[index], Automaton.Finite(to) ? 0 : -1});
+    }
+}
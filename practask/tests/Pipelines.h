@@ -0,0 +1,57 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Pipelines.h
+
+Abstract:
+
+    Reference compilation pipelines shared by tests and benchmarks.
+
+Author / Creation date:
+
+    JulesIMF / 19.10.26
+
+Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Includes / usings
+//
+
+#include <string>
+#include <Automaton.h>
+#include <Compiled.h>
+#include <Optimize.h>
+#include <Regexp.h>
+
+//
+// Definitions
+//
+
+//
+// Epsilon removal followed by the subset construction. Bisimilar
+// NDFSM states are merged if Reduction is given
+//
+
+inline CompiledAutomaton CompileViaEpsRemoval(std::string const& Regexp, AlphabetType const& Alphabet, ReductionStats* Reduction = nullptr)
+{
+    Automaton::StartUsing();
+
+    auto automaton = ParseReversePolishRegexp(Regexp, Alphabet);
+    automaton = RemoveEpsilonTransitions(automaton);
+    if (Reduction != nullptr)
+        automaton = CompactStates(ReduceBisimilar(CompactStates(automaton), Reduction));
+
+    automaton = NdfsmToDfsm(automaton, Alphabet);
+    automaton = RemoveUselessStates(automaton);
+
+    auto compiled = CompiledAutomaton::FromDfsm(automaton, Alphabet);
+    Automaton::EndUsing();
+    return compiled;
+}
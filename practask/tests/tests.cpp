@@ -24,9 +24,36 @@ Revision History:
 //
 
 #include "tests.h"
+#include "Pipelines.h"
 #include <Task.h>
 #include <Automaton.h>
 #include <Regexp.h>
+#include <Session.h>
+#include <Batch.h>
+#include <Server.h>
+#include <regsolver.h>
+#include <StaticRegexp.h>
+#include <Emit.h>
+#include <Optimize.h>
+#include <Scan.h>
+#include <Nfa.h>
+#include <Planner.h>
+#include <Budget.h>
+#include <PatternSet.h>
+#include <WordIndex.h>
+#include <Determinize.h>
+#include <Tables.h>
+#include <Runs.h>
+#include <BottomUp.h>
+#include <Ast.h>
+#include <random>
+#include <type_traits>
+#include <thread>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sstream>
 
 //
 // Definitions
@@ -65,6 +92,36 @@ TEST(TestDebug, Plug)
     DebugAutomaton(automaton, "automaton", "/tmp");
 }
 
+TEST(TestDebug, Names)
+{
+    AlphabetType ab = { 'a', 'b' };
+
+    //
+    // Production compilation names nothing but the regexp origins
+    //
+
+    auto automaton = ParseReversePolishRegexp("ab+", ab);
+    ASSERT_EQ(automaton.Initial->Name(), "+");
+    automaton = ThompsonToDfsm(automaton, ab);
+    ASSERT_EQ(automaton.Initial->Name(), "");
+    Automaton::EndUsing();
+
+    State::TrackProvenance();
+    automaton = ParseReversePolishRegexp("ab+", ab);
+    auto initialId = automaton.Initial->Id();
+    automaton = ThompsonToDfsm(automaton, ab);
+
+    auto name = automaton.Initial->Name();
+    ASSERT_NE(("|" + name + "|").find("|" + std::to_string(initialId) + "|"), std::string::npos);
+    ASSERT_EQ(std::count(name.begin(), name.end(), '|'), 2);
+    Automaton::EndUsing();
+
+    automaton = ParseReversePolishRegexp("a", ab);
+    automaton = ThompsonToDfsm(automaton, ab);
+    ASSERT_EQ(automaton.Initial->Name(), "");
+    Automaton::EndUsing();
+}
+
 TestExceptions::TestExceptions()
 {
     Automaton::StartUsing();
@@ -112,3 +169,1826 @@ TEST(TestExceptions, ExtraExpressions)
     ASSERT_THROW(ParseReversePolishRegexp("ababa", { 'a', 'b' }), std::runtime_error);
     ASSERT_THROW(ParseReversePolishRegexp("acb..bab.c.*.ab.", { 'a', 'b' }), std::runtime_error);
 }
+
+TEST(TestSession, MatchesWholeWord)
+{
+    auto automaton = CompileRegexp("acb..bab.c.*.ab.ba.+.+*a.", { 'a', 'b', 'c' });
+
+    for (std::string word : { "abbaa", "aaaa", "bbbb", "acbacbbabbabcbabbaacba", "abcbababcbacbbcabcaba", "" })
+    {
+        MatchSession session(automaton);
+        session.Append(word);
+        ASSERT_EQ(session.Longest(), SolveTask13(automaton, word));
+        ASSERT_EQ(session.Position(), word.length());
+    }
+}
+
+TEST(TestSession, Chunks)
+{
+    auto automaton = CompileRegexp("ab+c.aba.*.bac.+.+*1+", { 'a', 'b', 'c' });
+    std::string word = "ccccbcabababacbcaaabcab";
+
+    MatchSession session(automaton);
+    for (size_t idx = 0; idx < word.length(); idx += 3)
+    {
+        session.Append(std::string_view(word).substr(idx, 3));
+        auto prefixLen = std::min(word.length(), idx + 3);
+        ASSERT_EQ(session.Longest(), SolveTask13(automaton, std::string_view(word).substr(0, prefixLen)));
+    }
+
+    session.Reset();
+    session.Append("babc");
+    ASSERT_EQ(session.Longest(), 2);
+}
+
+TEST(TestBatch, InputOrder)
+{
+    std::stringstream input;
+    std::stringstream expected;
+
+    for (size_t idx = 0; idx != 2000; idx++)
+    {
+        switch (idx % 4)
+        {
+            case 0:
+                input << "ab+c.aba.*.bac.+.+*1+ bcabababacbc\n";
+                expected << "12\n";
+                break;
+
+            case 1:
+                input << "acb..bab.c.*.ab.ba.+.+*a. abbaa\n";
+                expected << "4\n";
+                break;
+
+            case 2:
+                input << "ab+c.aba.*.bac.+.+*1+\n";
+                expected << "0\n";
+                break;
+
+            case 3:
+                input << "ab.+ ab\n";
+                expected << "Error!Not enough operands for union (regexp_idx = 3)\n";
+                break;
+        }
+    }
+
+    std::stringstream output;
+    ThreadPool pool(4);
+    AutomataCache cache;
+    RunBatch(input, output, { 'a', 'b', 'c' }, pool, cache);
+
+    ASSERT_EQ(output.str(), expected.str());
+    ASSERT_EQ(cache.Misses(), 3);
+    ASSERT_EQ(cache.Hits(), 2000 - 3);
+}
+
+TEST(TestBatch, InvalidWord)
+{
+    AutomataCache cache;
+    ASSERT_EQ(SolveQuery("ab+ abd", { 'a', 'b' }, cache), "Error!Invalid symbol 'd' (word_idx = 2)");
+    ASSERT_EQ(cache.Misses(), 0);
+}
+
+TEST(TestBatch, CacheEviction)
+{
+    AutomataCache cache(2);
+    AlphabetType alphabet = { 'a', 'b' };
+
+    cache.Get("ab+", alphabet);
+    cache.Get("ab.", alphabet);
+    cache.Get("ab+", alphabet);
+    cache.Get("a*", alphabet);
+
+    ASSERT_EQ(cache.Size(), 2);
+    ASSERT_TRUE(cache.Contains("ab+", alphabet));
+    ASSERT_TRUE(cache.Contains("a*", alphabet));
+    ASSERT_FALSE(cache.Contains("ab.", alphabet));
+
+    //
+    // Malformed regexp is remembered, exhausted budget is not
+    //
+
+    ASSERT_THROW(cache.Get("ab.+", alphabet), std::runtime_error);
+    ASSERT_TRUE(cache.Contains("ab.+", alphabet));
+
+    {
+        Limits limits;
+        limits.MaxDfsmStates = 1;
+        Budget budget(limits);
+        ASSERT_THROW(cache.Get("ab+*a.b.", alphabet), BudgetExceeded);
+    }
+
+    ASSERT_FALSE(cache.Contains("ab+*a.b.", alphabet));
+    ASSERT_TRUE(cache.Contains("ab.+", alphabet));
+    ASSERT_EQ(cache.Size(), 1);
+}
+
+TEST(TestServer, Queries)
+{
+    std::string path = "/tmp/regsolver-test-" + std::to_string(getpid()) + ".sock";
+
+    ThreadPool pool(2);
+    Server server(path, pool);
+    std::thread serving([&server]() { server.Serve(); });
+
+    {
+        Client client(path);
+        ASSERT_EQ(client.Solve("ab+c.aba.*.bac.+.+*1+", "abc", "babc"), 2);
+        ASSERT_EQ(client.Solve("ab+c.aba.*.bac.+.+*1+", "abc", "bcabababacbc"), 12);
+        ASSERT_EQ(client.Solve("acb..bab.c.*.ab.ba.+.+*a.", "abc", "abbaa"), 4);
+        ASSERT_THROW(client.Solve("ab.+", "ab", "ab"), std::runtime_error);
+
+        auto stats = client.Stats();
+        ASSERT_NE(stats.find("requests 4\n"), std::string::npos);
+        ASSERT_NE(stats.find("errors 1\n"), std::string::npos);
+        ASSERT_NE(stats.find("cache_hits 1\n"), std::string::npos);
+        ASSERT_NE(stats.find("cache_misses 3\n"), std::string::npos);
+
+        size_t planned = 0;
+        for (size_t engine = 0; engine != EnginesCount; engine++)
+        {
+            auto line = std::string("engine_") + EngineName(Engine(engine)) + " ";
+            auto found = stats.find(line);
+            ASSERT_NE(found, std::string::npos);
+            planned += std::stoul(stats.substr(found + line.length()));
+        }
+
+        ASSERT_EQ(planned, 3);
+    }
+
+    server.Stop();
+    serving.join();
+}
+
+TEST(TestServer, MoreConnectionsThanWorkers)
+{
+    std::string path = "/tmp/regsolver-test-" + std::to_string(getpid()) + ".sock";
+
+    ThreadPool pool(2);
+    Server server(path, pool);
+    std::thread serving([&server]() { server.Serve(); });
+
+    {
+        //
+        // Idle clients must not hold the workers
+        //
+
+        std::vector<std::unique_ptr<Client>> clients;
+        for (size_t idx = 0; idx != 4; idx++)
+        {
+            clients.push_back(std::make_unique<Client>(path));
+            ASSERT_EQ(clients.back()->Solve("ab+*", "ab", std::string(idx, 'a')), idx);
+        }
+
+        for (size_t idx = 0; idx != 4; idx++)
+            ASSERT_EQ(clients[idx]->Solve("ab.*", "ab", "ababab"), 6);
+
+        //
+        // Frame split between writes is assembled
+        //
+
+        int fd = ConnectUnixSocket(path);
+        auto request = EncodeQuery("ab+", "ab", "b");
+        uint32_t length = uint32_t(request.length());
+        std::string frame(reinterpret_cast<char const*>(&length), sizeof(length));
+        frame += request;
+
+        ASSERT_EQ(write(fd, frame.data(), 3), 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_EQ(write(fd, frame.data() + 3, frame.length() - 3), ssize_t(frame.length() - 3));
+
+        std::string response;
+        ASSERT_TRUE(ReadFrame(fd, response));
+        ASSERT_EQ(DecodeAnswer(response), 1);
+        close(fd);
+    }
+
+    server.Stop();
+    serving.join();
+}
+
+TEST(TestServer, AcceptFailure)
+{
+    std::string path = "/tmp/regsolver-test-" + std::to_string(getpid()) + ".sock";
+
+    //
+    // Idle connection outlives the server
+    //
+
+    std::unique_ptr<Client> idle;
+    ThreadPool pool(2);
+    Server server(path, pool);
+    std::thread serving([&server]() { server.Serve(); });
+
+    idle = std::make_unique<Client>(path);
+    ASSERT_EQ(idle->Solve("ab+*", "ab", "abba"), 4);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+
+    //
+    // No free fd below the limit: accept() fails with EMFILE
+    //
+
+    rlimit saved = {};
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved), 0);
+    int lowest = dup(0);
+    close(lowest);
+
+    rlimit lowered = saved;
+    lowered.rlim_cur = rlim_t(lowest);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    WriteFrame(fd, EncodeQuery("ab.*", "ab", "abab"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &saved), 0);
+
+    //
+    // Accepted once the pause is over
+    //
+
+    std::string response;
+    ASSERT_TRUE(ReadFrame(fd, response));
+    ASSERT_EQ(DecodeAnswer(response), 4);
+    close(fd);
+
+    server.Stop();
+    serving.join();
+}
+
+TEST(TestServer, MalformedQuery)
+{
+    ASSERT_THROW(DecodeQuery("Q\x05"), std::runtime_error);
+    ASSERT_THROW(DecodeQuery(EncodeQuery("a", "a", "a") + "x"), std::runtime_error);
+
+    auto query = DecodeQuery(EncodeQuery("ab+", "ab", ""));
+    ASSERT_EQ(query.Regexp, "ab+");
+    ASSERT_EQ(query.Alphabet, "ab");
+    ASSERT_EQ(query.Word, "");
+}
+
+TEST(TestCApi, Match)
+{
+    std::string regexp = "acb..bab.c.*.ab.ba.+.+*a.";
+    auto handle = regsolver_compile(regexp.data(), regexp.length(), "abc", 3, nullptr);
+    ASSERT_NE(handle, nullptr);
+
+    //
+    // Only the first 5 symbols belong to the word
+    //
+
+    char const* buffer = "abbaacba";
+    ASSERT_EQ(regsolver_match(handle, buffer, 5), 4);
+    ASSERT_EQ(regsolver_match(handle, buffer, 0), 0);
+    ASSERT_EQ(regsolver_match(handle, "aaxa", 4), 1);
+
+    regsolver_free(handle);
+}
+
+TEST(TestCApi, Error)
+{
+    char* error = nullptr;
+    ASSERT_EQ(regsolver_compile("ab+c.", 5, "ab", 2, &error), nullptr);
+    ASSERT_STREQ(error, "Invalid symbol 'c' (regexp_idx = 3)");
+    regsolver_free_error(error);
+
+    ASSERT_EQ(regsolver_compile("", 0, "ab", 2, nullptr), nullptr);
+}
+
+TEST(TestCApi, Failure)
+{
+    auto handle = regsolver_compile("ab+*", 4, "ab", 2, nullptr);
+    ASSERT_NE(handle, nullptr);
+
+    std::string word;
+    for (size_t idx = 0; idx != (1 << 16); idx++)
+        word += "ab"[idx % 2];
+
+    //
+    // Matchers throw BudgetExceeded past the deadline, the C API reports it
+    //
+
+    {
+        Limits limits;
+        limits.Timeout = std::chrono::milliseconds(1);
+        ::Budget budget(limits);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        size_t begin = 0, end = 0;
+        ASSERT_EQ(regsolver_match(handle, word.data(), word.length()), REGSOLVER_MATCH_FAILED);
+        ASSERT_EQ(regsolver_find(handle, word.data(), word.length(), &begin, &end), -1);
+        ASSERT_EQ(regsolver_scan(handle, word.data(), word.length(), [](void*, size_t, size_t) {}, nullptr), -1);
+    }
+
+    ASSERT_EQ(regsolver_match(handle, word.data(), word.length()), word.length());
+    regsolver_free(handle);
+}
+
+static constexpr char FirstRegexp[] = "ab+c.aba.*.bac.+.+*1+";
+static constexpr char SecondRegexp[] = "acb..bab.c.*.ab.ba.+.+*a.";
+static constexpr char Abc[] = "abc";
+
+TEST(TestStaticRegexp, FirstRegexp)
+{
+    using Matcher = StaticRegexp<FirstRegexp, Abc>;
+    static_assert(Matcher::AlphabetSize == 3);
+    static_assert(std::is_same_v<Matcher::StateType, uint8_t>);
+
+    for (std::string word : { "babc", "aaaa", "", "bcabababacbc", "ccccbcabababacbc", "abxbc" })
+        ASSERT_EQ(Matcher::Solve(word), SolveTask13(FirstRegexp, word, { 'a', 'b', 'c', 'x' }));
+}
+
+TEST(TestStaticRegexp, SecondRegexp)
+{
+    using Matcher = StaticRegexp<SecondRegexp, Abc>;
+    static_assert(Matcher::StatesCount > 0 && Matcher::Finite.size() == Matcher::StatesCount);
+
+    for (std::string word : { "abbaa", "aaaa", "bbbb", "acbacbbabbabcbabbaacba", "abcbababcbacbbcabcaba" })
+        ASSERT_EQ(Matcher::Solve(word), SolveTask13(SecondRegexp, word, { 'a', 'b', 'c' }));
+}
+
+size_t EmittedMatcher(char const* Word, size_t WordLength);
+
+TEST(TestEmit, Minimize)
+{
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+    auto automaton = CompileRegexp(FirstRegexp, alphabet);
+    auto minimized = Minimize(automaton);
+    ASSERT_LE(minimized.StatesCount(), automaton.StatesCount());
+    ASSERT_EQ(Minimize(minimized).StatesCount(), minimized.StatesCount());
+
+    //
+    // (a + b)* needs a single state
+    //
+
+    ASSERT_EQ(Minimize(CompileRegexp("ab+*", alphabet)).StatesCount(), 1);
+
+    for (std::string word : { "babc", "aaaa", "", "bcabababacbc", "ccccbcabababacbc" })
+        ASSERT_EQ(SolveTask13(minimized, word), SolveTask13(automaton, word));
+}
+
+TEST(TestEmit, EmittedMatcher)
+{
+    for (std::string word : { "babc", "aaaa", "", "bcabababacbc", "ccccbcabababacbc", "abxbc" })
+        ASSERT_EQ(EmittedMatcher(word.data(), word.length()), SolveTask13(FirstRegexp, word, { 'a', 'b', 'c', 'x' }));
+
+    std::ostringstream emitted;
+    EmitCpp(CompileRegexp("ab.", { 'a', 'b' }), "Ab", emitted);
+    ASSERT_NE(emitted.str().find("size_t Ab(char const* Word, size_t WordLength)"), std::string::npos);
+    ASSERT_NE(emitted.str().find("case 97 /* 'a' */: goto s1;"), std::string::npos);
+}
+
+TEST(TestDeadStates, RemoveUselessStates)
+{
+    Automaton::StartUsing();
+
+    //
+    // 0 -a-> 1 (finite), 0 -b-> 2 -a-> 2: state 2 is useless
+    //
+
+    auto initial = State::Allocate();
+    auto finite = State::Allocate();
+    auto useless = State::Allocate();
+    finite->SetFinite();
+
+    initial->Connect(finite, 'a');
+    initial->Connect(useless, 'b');
+    useless->Connect(useless, 'a');
+
+    auto trimmed = RemoveUselessStates(Automaton(initial));
+    ASSERT_EQ(trimmed.Initial->To('a'), finite);
+    ASSERT_EQ(trimmed.Initial->To('b'), nullptr);
+    ASSERT_TRUE(useless->InputTransitions().empty());
+
+    auto compiled = CompiledAutomaton::FromDfsm(trimmed, { 'a', 'b' });
+    ASSERT_EQ(compiled.StatesCount(), 2);
+
+    Automaton::EndUsing();
+}
+
+TEST(TestDeadStates, CompactStates)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    //
+    // Garbage of an earlier automaton and the orphaned Thompson states
+    // are freed, passes see only the live automaton
+    //
+
+    ParseReversePolishRegexp(SecondRegexp, abc);
+    auto automaton = ParseReversePolishRegexp(FirstRegexp, abc);
+    auto thompsonStates = State::AllocatedStates().size();
+
+    automaton = ThompsonToDfsm(automaton, abc);
+    automaton = CompactStates(automaton);
+    auto dfsmStates = CollectReachable(automaton.Initial).size();
+    ASSERT_EQ(State::AllocatedStates().size(), dfsmStates);
+    ASSERT_LT(dfsmStates, thompsonStates);
+
+    for (auto state : State::AllocatedStates())
+        for (auto const& transition : state->InputTransitions())
+            ASSERT_NE(State::AllocatedStates().find(transition.From), State::AllocatedStates().end());
+
+    auto compacted = CompiledAutomaton::FromDfsm(RemoveUselessStates(automaton), abc);
+    Automaton::EndUsing();
+
+    ASSERT_EQ(SolveTask13(compacted, "babc"), 2);
+
+    automaton = ParseReversePolishRegexp(SecondRegexp, abc);
+    ParseReversePolishRegexp(FirstRegexp, abc);
+    automaton = CompactStates(RemoveEpsilonTransitions(automaton));
+    automaton = CompactStates(NdfsmToDfsm(automaton, abc));
+    ASSERT_EQ(State::AllocatedStates().size(), CollectReachable(automaton.Initial).size());
+
+    auto viaEpsRemoval = CompiledAutomaton::FromDfsm(RemoveUselessStates(automaton), abc);
+    Automaton::EndUsing();
+
+    ASSERT_EQ(SolveTask13(viaEpsRemoval, "abbaa"), 4);
+}
+
+TEST(TestDeadStates, TrimDeadStates)
+{
+    using StateId = CompiledAutomaton::StateId;
+
+    //
+    // State 2 is an explicit sink
+    //
+
+    std::vector<StateId> table = { 1, 2,   2, 2,   2, 2 };
+    auto completed = CompiledAutomaton::FromTable("ab", table, { 0, 1, 0 });
+    auto trimmed = TrimDeadStates(completed);
+
+    ASSERT_EQ(trimmed.StatesCount(), 2);
+    ASSERT_EQ(trimmed.Step(0, 'b'), CompiledAutomaton::Dead);
+    ASSERT_EQ(trimmed.Step(1, 'a'), CompiledAutomaton::Dead);
+
+    MatchStats completedStats, trimmedStats;
+    ASSERT_EQ(SolveTask13(completed, "bbbbab", &completedStats), 1);
+    ASSERT_EQ(SolveTask13(trimmed, "bbbbab", &trimmedStats), 1);
+    ASSERT_LT(trimmedStats.SymbolsStepped, completedStats.SymbolsStepped);
+}
+
+TEST(TestPrefilter, ByteScanner)
+{
+    std::mt19937 rng(7);
+    std::string text(1000, '\0');
+    for (auto& sym : text)
+        sym = char(rng() % 256);
+
+    for (size_t setSize = 0; setSize != 12; setSize++)
+    {
+        std::string bytes;
+        for (size_t idx = 0; idx != setSize; idx++)
+            bytes += char(rng() % 256);
+
+        ByteScanner scanner(bytes);
+        for (size_t begin = 0; begin < text.length(); begin += 37)
+        {
+            auto expected = text.find_first_of(bytes, begin);
+            auto found = scanner.Find(text.data() + begin, text.data() + text.length());
+            ASSERT_EQ(size_t(found - text.data()), expected == std::string::npos ? text.length() : expected);
+        }
+    }
+}
+
+TEST(TestPrefilter, ShuffleKernel)
+{
+    std::mt19937 rng(13);
+    std::string text(1000, '\0');
+    for (auto& sym : text)
+        sym = char(rng() % 256);
+
+    auto end = text.data() + text.length();
+
+    //
+    // Single byte against memchr, small sets against the lookup table
+    //
+
+    for (size_t sym = 0; sym != 256; sym++)
+    {
+        ByteScanner scanner(std::string(1, char(sym)));
+        for (size_t begin = 0; begin < text.length(); begin += 61)
+        {
+            auto found = memchr(text.data() + begin, int(sym), text.length() - begin);
+            auto expected = found ? static_cast<char const*>(found) : end;
+            ASSERT_EQ(scanner.FindShuffle(text.data() + begin, end), expected);
+        }
+    }
+
+    for (size_t setSize = 2; setSize != 9; setSize++)
+    {
+        std::string bytes;
+        for (size_t idx = 0; idx != setSize; idx++)
+            bytes += char(0x10 * idx + rng() % 16);
+
+        ByteScanner scanner(bytes);
+        for (size_t begin = 0; begin < text.length(); begin += 7)
+            ASSERT_EQ(scanner.FindShuffle(text.data() + begin, end), scanner.FindScalar(text.data() + begin, end));
+    }
+}
+
+TEST(TestPrefilter, FirstSymbols)
+{
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    auto automaton = CompileRegexp("ab.c.b*.", alphabet);
+    ASSERT_EQ(automaton.FirstSymbols().Bytes(), "a");
+    ASSERT_EQ(automaton.RequiredPrefix(), "abc");
+
+    automaton = CompileRegexp(FirstRegexp, alphabet);
+    ASSERT_EQ(automaton.FirstSymbols().Bytes(), "ab");
+    ASSERT_EQ(automaton.RequiredPrefix(), "");
+
+    ASSERT_EQ(SolveTask13(CompileRegexp("ab.c.b*.", alphabet), "cccabcbbcabcccab"), 5);
+    ASSERT_EQ(SolveTask13(CompileRegexp("1", alphabet), "abc"), 0);
+}
+
+TEST(TestPrefilter, MatchesSession)
+{
+    std::mt19937 rng(11);
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    for (auto regexp : { FirstRegexp, SecondRegexp, "ab.c.b*.", "ca.*b.", "a*b.c+", "cc.c.a." })
+    {
+        auto automaton = CompileRegexp(regexp, alphabet);
+        for (size_t test = 0; test != 50; test++)
+        {
+            std::string word(rng() % 60, '\0');
+            for (auto& sym : word)
+                sym = "abccccc"[rng() % 7];
+
+            MatchSession session(automaton);
+            session.Append(word);
+            ASSERT_EQ(SolveTask13(automaton, word), session.Longest()) << regexp << " " << word;
+        }
+    }
+}
+
+TEST(TestLengthBounds, Analysis)
+{
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+    auto const unbounded = CompiledAutomaton::Unbounded;
+
+    struct
+    {
+        char const* Regexp;
+        size_t Min, Max;
+    } cases[] =
+    {
+        { "ab.c.",     3, 3 },
+        { "ab.1+",     0, 2 },
+        { "ab+c.a+",   1, 2 },
+        { "ab+*",      0, unbounded },
+        { "ab.a*.",    2, unbounded },
+        { FirstRegexp, 0, unbounded },
+        { SecondRegexp, 1, unbounded },
+    };
+
+    for (auto const& test : cases)
+    {
+        auto automaton = CompileRegexp(test.Regexp, alphabet);
+        ASSERT_EQ(automaton.MinLength(), test.Min) << test.Regexp;
+        ASSERT_EQ(automaton.MaxLength(), test.Max) << test.Regexp;
+    }
+}
+
+TEST(TestLengthBounds, Matching)
+{
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    //
+    // Scan stops as soon as the longest possible word is found
+    //
+
+    auto automaton = CompileRegexp("ab.c.ab+.", alphabet);
+    std::string word = "abcb" + std::string(1000, 'a');
+
+    MatchStats stats;
+    ASSERT_EQ(SolveTask13(automaton, word, &stats), 4);
+    ASSERT_EQ(stats.Starts, 1);
+
+    ASSERT_EQ(SolveTask13(automaton, "abc"), 0);
+    ASSERT_EQ(SolveTask13(CompileRegexp("ab.1+", alphabet), "cabab"), 2);
+}
+
+//
+// Random well-formed reverse polish regexp over abc
+//
+
+std::string RandomRegexp(std::mt19937& Rng, size_t Operands)
+{
+    std::string regexp;
+    size_t stack = 0;
+
+    while (Operands != 0 || stack != 1)
+    {
+        auto choice = Rng() % 6;
+        if (Operands != 0 && (stack < 2 || choice < 3))
+        {
+            regexp += "abc1"[Rng() % 4];
+            stack++;
+            Operands--;
+        }
+
+        else if (choice == 3)
+            regexp += '*';
+
+        else
+        {
+            regexp += (choice == 4) ? '+' : '.';
+            stack--;
+        }
+    }
+
+    return regexp;
+}
+
+//
+// Answer of a compiled automaton or of a matcher taking the word
+//
+
+size_t SolveWith(CompiledAutomaton const& Automaton, std::string const& Word)
+{
+    return SolveTask13(Automaton, Word);
+}
+
+template <typename Matcher>
+size_t SolveWith(Matcher const& Match, std::string const& Word)
+{
+    return Match(Word);
+}
+
+//
+// Make(Regexp) must answer random words over Symbols as the eps-removal
+// pipeline does. If it returns a compiled automaton, the minimized DFSM
+// and the lengths of words are compared as well
+//
+
+template <typename MakeFunction>
+void ExpectSameLanguage(std::mt19937& Rng, MakeFunction Make, size_t Tests = 100, std::string const& Symbols = "abc")
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    for (size_t test = 0; test != Tests; test++)
+    {
+        auto regexp = RandomRegexp(Rng, 1 + Rng() % 14);
+        auto expected = CompileViaEpsRemoval(regexp, abc);
+        auto made = Make(regexp);
+
+        if constexpr (std::is_same_v<decltype(made), CompiledAutomaton>)
+        {
+            ASSERT_EQ(Minimize(made).StatesCount(), Minimize(expected).StatesCount()) << regexp;
+            ASSERT_EQ(made.MinLength(), expected.MinLength()) << regexp;
+            ASSERT_EQ(made.MaxLength(), expected.MaxLength()) << regexp;
+        }
+
+        for (size_t words = 0; words != 4; words++)
+        {
+            std::string word(Rng() % 50, '\0');
+            for (auto& sym : word)
+                sym = Symbols[Rng() % Symbols.size()];
+
+            ASSERT_EQ(SolveWith(made, word), SolveTask13(expected, word)) << regexp << " " << word;
+        }
+    }
+}
+
+TEST(TestPlanner, EnginesAgree)
+{
+    std::mt19937 rng(17);
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    for (size_t test = 0; test != 300; test++)
+    {
+        auto regexp = RandomRegexp(rng, 1 + rng() % 12);
+        std::string word(rng() % 40, '\0');
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+
+        auto expected = SolveTask13(CompileRegexp(regexp, alphabet), word);
+        auto nfa = CompileNfa(regexp, alphabet);
+
+        ASSERT_EQ(SolveNfa(nfa, word), expected) << regexp << " " << word;
+        ASSERT_EQ(SolveLazyDfsm(nfa, word), expected) << regexp << " " << word;
+        ASSERT_EQ(SolveBitParallel(nfa, word), expected) << regexp << " " << word;
+        ASSERT_EQ(SolvePlanned(regexp, word, alphabet), expected) << regexp << " " << word;
+    }
+}
+
+TEST(TestPlanner, LazyDfsmFlush)
+{
+    AlphabetType alphabet = { 'a', 'b' };
+    auto nfa = CompileNfa("ab+*a.ab+.ab+.ab+.", alphabet);
+
+    LazyDfsm automaton(nfa, 4);
+    auto current = automaton.Initial();
+    for (auto sym : std::string("abbabaabbbaaab"))
+    {
+        current = automaton.Step(current, sym);
+        ASSERT_NE(current, LazyDfsm::Dead);
+    }
+
+    ASSERT_GT(automaton.Flushes(), 0);
+    ASSERT_LE(automaton.StatesCount(), 4);
+
+    //
+    // a at the fourth position from the end
+    //
+
+    ASSERT_TRUE(automaton.Finite(current));
+}
+
+TEST(TestPlanner, Shape)
+{
+    auto shape = AnalyzeShape("ab+*a.ab+.ab+.");
+    ASSERT_EQ(shape.ThompsonStates, 21);
+    ASSERT_EQ(shape.Symbols, 7);
+    ASSERT_EQ(shape.StarDepth, 1);
+    ASSERT_EQ(shape.UnionFanout, 2);
+    ASSERT_EQ(shape.Branching, 2);
+    ASSERT_EQ(shape.FirstSymbols, 2);
+
+    shape = AnalyzeShape(FirstRegexp);
+    ASSERT_EQ(shape.StarDepth, 2);
+    ASSERT_EQ(shape.UnionFanout, 2);
+
+    ASSERT_EQ(AnalyzeShape("abc++a.").UnionFanout, 3);
+    ASSERT_EQ(AnalyzeShape("1a*.b.").FirstSymbols, 2);
+}
+
+TEST(TestPlanner, Choice)
+{
+    //
+    // DFSM of (a + b)* a (a + b)^16 has 2^17 states
+    //
+
+    std::string blowup = "ab+*a.";
+    for (size_t idx = 0; idx != 16; idx++)
+        blowup += "ab+.";
+
+    ASSERT_NE(PlanQuery(blowup, 3, 4096).Chosen, Engine::Dfsm);
+    ASSERT_EQ(PlanQuery("ab.c.ab+.", 3, 1 << 16).Chosen, Engine::Dfsm);
+    ASSERT_EQ(PlanQuery("ab+*c.", 3, 1 << 16).Chosen, Engine::Nfa);
+    ASSERT_EQ(PlanQuery("ab.c.ba.c.+", 3, 2048).Chosen, Engine::BitParallel);
+
+    //
+    // Too many states for a machine word
+    //
+
+    std::string literal = "a";
+    for (size_t idx = 0; idx != 80; idx++)
+        literal += "b.";
+
+    ASSERT_NE(PlanQuery(literal, 3, 100).Chosen, Engine::BitParallel);
+}
+
+std::string BlowupRegexp(size_t Tail)
+{
+    std::string regexp = "ab+*a.";
+    for (size_t idx = 0; idx != Tail; idx++)
+        regexp += "ab+.";
+
+    return regexp;
+}
+
+TEST(TestBudget, DfsmStates)
+{
+    AlphabetType alphabet = { 'a', 'b' };
+
+    Limits limits;
+    limits.MaxDfsmStates = 100;
+    Budget budget(limits);
+
+    try
+    {
+        CompileRegexp(BlowupRegexp(8), alphabet);
+        FAIL();
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::DfsmStates);
+    }
+
+    //
+    // States allocator is left clean
+    //
+
+    ASSERT_TRUE(State::AllocatedStates().empty());
+    budget.ResetUsage();
+    ASSERT_EQ(SolveTask13(CompileRegexp(FirstRegexp, { 'a', 'b', 'c' }), "babc"), 2);
+}
+
+TEST(TestBudget, Fallback)
+{
+    AlphabetType alphabet = { 'a', 'b' };
+    auto regexp = BlowupRegexp(8);
+    std::string word = "bbbabbbbbbab";
+
+    Limits limits;
+    limits.MaxDfsmStates = 100;
+    Budget budget(limits);
+
+    QueryPlan plan;
+    plan.Chosen = Engine::Dfsm;
+    ASSERT_EQ(RunPlan(plan, regexp, word, alphabet), 12);
+    ASSERT_TRUE(plan.FellBack);
+    ASSERT_EQ(plan.Chosen, Engine::Nfa);
+
+    //
+    // Planner does not pick a DFSM estimated over the limit
+    //
+
+    ASSERT_NE(PlanQuery(regexp, 2, 1 << 20).Chosen, Engine::Dfsm);
+}
+
+TEST(TestBudget, Deadline)
+{
+    AlphabetType alphabet = { 'a', 'b', 'c' };
+
+    //
+    // Every start runs to the end of the word without a c (no runs
+    // for the run-length mode to skip)
+    //
+
+    auto automaton = CompileRegexp("ab+*c.", alphabet);
+    std::string word;
+    for (size_t idx = 0; idx != 100000; idx++)
+        word += "ab";
+
+    Limits limits;
+    limits.Timeout = std::chrono::milliseconds(20);
+    Budget budget(limits);
+
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        SolveTask13(automaton, word);
+        FAIL();
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::Deadline);
+    }
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+    //
+    // Deadline is not a reason to fall back
+    //
+
+    QueryPlan plan;
+    plan.Chosen = Engine::Dfsm;
+    ASSERT_THROW(RunPlan(plan, "ab+*c.", word, alphabet), BudgetExceeded);
+    ASSERT_FALSE(plan.FellBack);
+}
+
+TEST(TestBudget, Bytes)
+{
+    Limits limits;
+    limits.MaxBytes = 4096;
+
+    AutomataCache cache;
+    ASSERT_EQ(SolveQuery(std::string(FirstRegexp) + " babc", { 'a', 'b', 'c' }, cache, limits),
+        "Error!Budget exceeded: memory limit");
+
+    //
+    // Failure is not cached
+    //
+
+    ASSERT_EQ(SolveQuery(std::string(FirstRegexp) + " babc", { 'a', 'b', 'c' }, cache), "2");
+}
+
+TEST(TestBudget, SharedCompilation)
+{
+    AlphabetType alphabet = { 'a', 'b' };
+    auto regexp = BlowupRegexp(14);
+
+    //
+    // Waiter of a compilation that ran out of its caller's budget
+    // compiles under its own one
+    //
+
+    AutomataCache cache;
+    std::thread limited([&]()
+    {
+        Limits limits;
+        limits.MaxDfsmStates = 1 << 14;
+        Budget budget(limits);
+        ASSERT_THROW(cache.Get(regexp, alphabet), BudgetExceeded);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_NE(cache.Get(regexp, alphabet), nullptr);
+    limited.join();
+
+    //
+    // Waiter gives up at its own deadline
+    //
+
+    AutomataCache other;
+    std::thread unlimited([&]() { ASSERT_NE(other.Get(regexp, alphabet), nullptr); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    {
+        Limits limits;
+        limits.Timeout = std::chrono::milliseconds(1);
+        Budget budget(limits);
+
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            other.Get(regexp, alphabet);
+            FAIL();
+        }
+
+        catch (BudgetExceeded const& e)
+        {
+            ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::Deadline);
+        }
+
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    }
+
+    unlimited.join();
+}
+
+TEST(TestBudget, Server)
+{
+    std::string path = "/tmp/regsolver-budget-" + std::to_string(getpid()) + ".sock";
+
+    Limits limits;
+    limits.MaxBytes = 4096;
+
+    ThreadPool pool(1);
+    Server server(path, pool, limits);
+    std::thread serving([&server]() { server.Serve(); });
+
+    {
+        Client client(path);
+        ASSERT_EQ(client.Solve("ab.", "ab", "bab"), 2);
+
+        try
+        {
+            client.Solve(FirstRegexp, "abc", "babc");
+            FAIL();
+        }
+
+        catch (BudgetExceeded const& e)
+        {
+            ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::Bytes);
+        }
+
+        auto stats = client.Stats();
+        ASSERT_NE(stats.find("budget_exceeded 1\n"), std::string::npos);
+        ASSERT_NE(stats.find("errors 0\n"), std::string::npos);
+    }
+
+    server.Stop();
+    serving.join();
+}
+
+//
+// Whole [Begin, End) accepted
+//
+
+bool Accepts(CompiledAutomaton const& Automaton, std::string_view Word, size_t Begin, size_t End)
+{
+    auto state = Automaton.Initial();
+    for (auto position = Begin; position != End; position++)
+    {
+        state = Automaton.Step(state, Word[position]);
+        if (state == CompiledAutomaton::Dead)
+            return false;
+    }
+
+    return Automaton.Finite(state);
+}
+
+TEST(TestSpans, LeftmostLongest)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    auto second = CompileRegexp(SecondRegexp, abc);
+    auto span = FindLongestMatch(second, "cabbaa");
+    ASSERT_TRUE(span.has_value());
+    ASSERT_EQ(span->Begin, 2);
+    ASSERT_EQ(span->End, 6);
+
+    //
+    // Two of length 2, the left one wins; empty word only at 0
+    //
+
+    auto ab = CompileRegexp("ab.", abc);
+    span = FindLongestMatch(ab, "cabcab");
+    ASSERT_EQ(span->Begin, 1);
+    ASSERT_EQ(span->End, 3);
+    ASSERT_FALSE(FindLongestMatch(ab, "ccc").has_value());
+
+    auto first = CompileRegexp(FirstRegexp, abc);
+    span = FindLongestMatch(first, "ccc");
+    ASSERT_TRUE(span.has_value());
+    ASSERT_EQ(span->Length(), 0);
+
+    std::mt19937 rng(37);
+    for (size_t test = 0; test != 300; test++)
+    {
+        auto automaton = CompileRegexp(RandomRegexp(rng, 1 + rng() % 10), abc);
+        std::string word(rng() % 30, '\0');
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+
+        std::optional<MatchSpan> expected;
+        for (size_t begin = 0; begin <= word.length(); begin++)
+            for (size_t end = begin; end <= word.length(); end++)
+                if (Accepts(automaton, word, begin, end) && (!expected || end - begin > expected->Length()))
+                    expected = MatchSpan{begin, end};
+
+        auto found = FindLongestMatch(automaton, word);
+        ASSERT_EQ(found.has_value(), expected.has_value()) << word;
+
+        MatchSession session(automaton);
+        session.Append(word);
+        auto streamed = session.LongestSpan();
+        ASSERT_EQ(streamed.has_value(), expected.has_value()) << word;
+
+        if (!expected)
+            continue;
+
+        ASSERT_EQ(found->Begin, expected->Begin) << word;
+        ASSERT_EQ(found->End, expected->End) << word;
+
+        //
+        // Empty words are not spans of the session beyond position 0
+        //
+
+        if (expected->Length() != 0)
+        {
+            ASSERT_EQ(streamed->Begin, expected->Begin) << word;
+            ASSERT_EQ(streamed->End, expected->End) << word;
+        }
+    }
+}
+
+TEST(TestSpans, EveryEnd)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(41);
+
+    for (size_t test = 0; test != 300; test++)
+    {
+        auto automaton = CompileRegexp(RandomRegexp(rng, 1 + rng() % 10), abc);
+        std::string word(rng() % 30, '\0');
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+
+        std::vector<std::pair<size_t, size_t>> expected;
+        for (size_t end = 1; end <= word.length(); end++)
+            for (size_t begin = 0; begin <= end; begin++)
+                if (Accepts(automaton, word, begin, end))
+                {
+                    expected.emplace_back(begin, end);
+                    break;
+                }
+
+        //
+        // Chunk borders do not matter
+        //
+
+        std::vector<std::pair<size_t, size_t>> reported;
+        auto onEnd = [&reported](size_t Begin, size_t End) { reported.emplace_back(Begin, End); };
+
+        MatchSession session(automaton);
+        auto split = word.length() ? rng() % word.length() : 0;
+        session.Append(std::string_view(word).substr(0, split), onEnd);
+        session.Append(std::string_view(word).substr(split), onEnd);
+
+        ASSERT_EQ(reported, expected) << word;
+    }
+}
+
+void CollectEnd(void* Context, size_t Begin, size_t End)
+{
+    static_cast<std::vector<std::pair<size_t, size_t>>*>(Context)->emplace_back(Begin, End);
+}
+
+TEST(TestSpans, CApi)
+{
+    auto handle = regsolver_compile(SecondRegexp, strlen(SecondRegexp), "abc", 3, nullptr);
+    ASSERT_NE(handle, nullptr);
+
+    size_t begin = 0, end = 0;
+    ASSERT_EQ(regsolver_find(handle, "cabbaa", 6, &begin, &end), 1);
+    ASSERT_EQ(begin, 2);
+    ASSERT_EQ(end, 6);
+    ASSERT_EQ(regsolver_find(handle, "ccc", 3, &begin, &end), 0);
+
+    std::vector<std::pair<size_t, size_t>> reported;
+    ASSERT_EQ(regsolver_scan(handle, "cabbaa", 6, CollectEnd, &reported), 0);
+
+    std::vector<std::pair<size_t, size_t>> expected = { {1, 2}, {4, 5}, {2, 6} };
+    ASSERT_EQ(reported, expected);
+
+    regsolver_free(handle);
+}
+
+TEST(TestPatternSet, MatchesSeparateScans)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(43);
+
+    for (size_t test = 0; test != 50; test++)
+    {
+        std::vector<std::string> regexps(1 + rng() % 12);
+        for (auto& regexp : regexps)
+            regexp = RandomRegexp(rng, 1 + rng() % 8);
+
+        std::string word(rng() % 60, '\0');
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+
+        auto set = PatternSet::Compile(regexps, abc);
+        auto longest = set.Solve(word);
+        ASSERT_EQ(longest.size(), regexps.size());
+
+        for (size_t pattern = 0; pattern != regexps.size(); pattern++)
+            ASSERT_EQ(longest[pattern], SolveTask13(CompileRegexp(regexps[pattern], abc), word))
+                << regexps[pattern] << " " << word;
+    }
+}
+
+TEST(TestPatternSet, Groups)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::vector<std::string> regexps = { FirstRegexp, SecondRegexp, "ab.", "c*", "ba+*c." };
+
+    auto whole = PatternSet::Compile(regexps, abc);
+    ASSERT_EQ(whole.GroupsCount(), 1);
+
+    //
+    // Tiny product limit leaves a group per pattern
+    //
+
+    auto split = PatternSet::Compile(regexps, abc, 2);
+    ASSERT_EQ(split.GroupsCount(), regexps.size());
+
+    std::string word = "abbaacbcccabab";
+    ASSERT_EQ(split.Solve(word), whole.Solve(word));
+    ASSERT_EQ(whole.Solve(word), (std::vector<size_t>{ 5, 4, 2, 3, 6 }));
+
+    //
+    // More patterns than a mask holds
+    //
+
+    std::vector<std::string> many(PatternSet::GroupPatterns + 3, "ab.");
+    many.back() = "c";
+    auto wide = PatternSet::Compile(many, abc);
+    ASSERT_EQ(wide.GroupsCount(), 2);
+
+    auto longest = wide.Solve("abc");
+    ASSERT_EQ(longest.front(), 2);
+    ASSERT_EQ(longest.back(), 1);
+}
+
+TEST(TestWordIndex, Substrings)
+{
+    std::string word = "abbaacbcccabab";
+    WordIndex index(word);
+    ASSERT_LE(index.StatesCount(), 2 * word.length());
+
+    for (size_t begin = 0; begin <= word.length(); begin++)
+        for (size_t end = begin; end <= word.length(); end++)
+            ASSERT_TRUE(index.Contains(std::string_view(word).substr(begin, end - begin)));
+
+    ASSERT_FALSE(index.Contains("bab b"));
+    ASSERT_FALSE(index.Contains("aaa"));
+    ASSERT_FALSE(index.Contains("cbb"));
+}
+
+TEST(TestWordIndex, MatchesScan)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(47);
+
+    for (size_t test = 0; test != 40; test++)
+    {
+        std::string word(rng() % 200, '\0');
+        for (auto& sym : word)
+            sym = "abcx"[rng() % (test % 2 ? 4 : 3)];
+
+        WordIndex index(word);
+
+        for (size_t query = 0; query != 10; query++)
+        {
+            auto regexp = RandomRegexp(rng, 1 + rng() % 10);
+            auto automaton = CompileRegexp(regexp, abc);
+            ASSERT_EQ(index.Solve(automaton), SolveTask13(automaton, word)) << regexp << " " << word;
+        }
+    }
+
+    WordIndex empty("");
+    ASSERT_EQ(empty.Solve(CompileRegexp(FirstRegexp, abc)), 0);
+}
+
+bool SameTables(CompiledAutomaton const& First, CompiledAutomaton const& Second)
+{
+    if (First.StatesCount() != Second.StatesCount() || First.Symbols() != Second.Symbols())
+        return false;
+
+    for (CompiledAutomaton::StateId state = 0; state != First.StatesCount(); state++)
+    {
+        if (First.Finite(state) != Second.Finite(state))
+            return false;
+
+        for (auto sym : First.Symbols())
+            if (First.Step(state, sym) != Second.Step(state, sym))
+                return false;
+    }
+
+    return true;
+}
+
+TEST(TestDeterminize, MatchesSequential)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(53);
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp) { return CompileRegexpParallel(Regexp, abc, 4); });
+}
+
+TEST(TestDeterminize, Reproducible)
+{
+    AlphabetType ab = { 'a', 'b' };
+    auto nfa = CompileNfa(BlowupRegexp(10), ab);
+
+    auto single = DeterminizeParallel(nfa, 1);
+    ASSERT_EQ(Minimize(single).StatesCount(), Minimize(CompileRegexp(BlowupRegexp(10), ab)).StatesCount());
+
+    for (size_t threads : { 2, 3, 8 })
+        for (size_t run = 0; run != 3; run++)
+            ASSERT_TRUE(SameTables(DeterminizeParallel(nfa, threads), single)) << threads;
+}
+
+TEST(TestDeterminize, Budget)
+{
+    AlphabetType ab = { 'a', 'b' };
+    auto nfa = CompileNfa(BlowupRegexp(12), ab);
+
+    Limits limits;
+    limits.MaxDfsmStates = 100;
+    ::Budget budget(limits);
+
+    try
+    {
+        DeterminizeParallel(nfa, 4);
+        FAIL();
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::DfsmStates);
+    }
+}
+
+TEST(TestDeterminize, BudgetInEveryWorker)
+{
+    AlphabetType ab = { 'a', 'b' };
+    auto nfa = CompileNfa(BlowupRegexp(16), ab);
+
+    for (size_t threads : { 1, 4 })
+    {
+        Limits limits;
+        limits.MaxBytes = 1 << 16;
+        ::Budget budget(limits);
+
+        try
+        {
+            DeterminizeParallel(nfa, threads);
+            FAIL();
+        }
+
+        catch (BudgetExceeded const& e)
+        {
+            ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::Bytes);
+        }
+    }
+
+    Limits limits;
+    limits.Timeout = std::chrono::milliseconds(5);
+    ::Budget budget(limits);
+
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        DeterminizeParallel(nfa, 4);
+        FAIL();
+    }
+
+    catch (BudgetExceeded const& e)
+    {
+        ASSERT_EQ(e.Exhausted(), BudgetExceeded::Resource::Deadline);
+    }
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST(TestDeterminize, ThompsonClosures)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(59);
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp) { return CompileRegexp(Regexp, abc); });
+
+    //
+    // Closures are not contracted into transitions
+    //
+
+    Limits limits;
+    size_t closuresBytes = 0, epsRemovalBytes = 0;
+    {
+        ::Budget budget(limits);
+        CompileRegexp(FirstRegexp, abc);
+        closuresBytes = budget.UsedBytes();
+    }
+    {
+        ::Budget budget(limits);
+        CompileViaEpsRemoval(FirstRegexp, abc);
+        epsRemovalBytes = budget.UsedBytes();
+    }
+
+    ASSERT_LT(closuresBytes, epsRemovalBytes);
+}
+
+TEST(TestLayout, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(61);
+    std::vector<std::string_view> samples = { "abbaacbab", "bbabbaab", "acbacba" };
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp)
+    {
+        return RenumberBreadthFirst(Minimize(CompileRegexp(Regexp, abc)));
+    });
+
+    ExpectSameLanguage(rng, [&abc, &samples](std::string const& Regexp)
+    {
+        auto automaton = Minimize(CompileRegexp(Regexp, abc));
+        return RenumberByVisits(automaton, CountVisits(automaton, samples));
+    });
+}
+
+TEST(TestLayout, Orders)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    auto automaton = CompileRegexp(SecondRegexp, abc);
+
+    //
+    // Every state is discovered from a smaller one
+    //
+
+    auto breadthFirst = RenumberBreadthFirst(automaton);
+    std::vector<uint8_t> discovered(breadthFirst.StatesCount(), 0);
+    discovered[0] = 1;
+    CompiledAutomaton::StateId next = 1;
+
+    for (CompiledAutomaton::StateId state = 0; state != breadthFirst.StatesCount(); state++)
+    {
+        ASSERT_TRUE(discovered[state]);
+        for (auto sym : breadthFirst.Symbols())
+        {
+            auto to = breadthFirst.Step(state, sym);
+            if (to != CompiledAutomaton::Dead && !discovered[to])
+            {
+                ASSERT_EQ(to, next++);
+                discovered[to] = 1;
+            }
+        }
+    }
+
+    //
+    // Visits do not increase after the initial state
+    //
+
+    std::vector<std::string_view> samples = { "abbaacbab", "bbabbaab", "acbacba" };
+    auto byVisits = RenumberByVisits(automaton, CountVisits(automaton, samples));
+    auto visits = CountVisits(byVisits, samples);
+
+    ASSERT_GT(visits[1], 0);
+    for (size_t state = 2; state < visits.size(); state++)
+        ASSERT_LE(visits[state], visits[state - 1]);
+}
+
+TEST(TestTables, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(67);
+
+    //
+    // d is out of the alphabet
+    //
+
+    auto matcher = [&abc](auto FromCompiled)
+    {
+        return [&abc, FromCompiled](std::string const& Regexp)
+        {
+            auto table = FromCompiled(CompileRegexp(Regexp, abc));
+            return [table](std::string const& Word) { return SolveTable(table, Word); };
+        };
+    };
+
+    ExpectSameLanguage(rng, matcher(&DenseTable<uint16_t>::FromCompiled), 50, "abcd");
+    ExpectSameLanguage(rng, matcher(&DenseTable<uint32_t>::FromCompiled), 50, "abcd");
+    ExpectSameLanguage(rng, matcher(&CombTable<uint16_t>::FromCompiled), 50, "abcd");
+    ExpectSameLanguage(rng, matcher(&CombTable<uint32_t>::FromCompiled), 50, "abcd");
+}
+
+TEST(TestTables, Steps)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    auto automaton = CompileRegexp(SecondRegexp, abc);
+    auto comb = CombTable<uint16_t>::FromCompiled(automaton);
+
+    for (CompiledAutomaton::StateId state = 0; state != automaton.StatesCount(); state++)
+    {
+        ASSERT_EQ(comb.Finite(uint16_t(state)), automaton.Finite(state));
+        for (auto sym : { 'a', 'b', 'c', 'd' })
+        {
+            auto to = automaton.Step(state, sym);
+            auto packed = comb.Step(uint16_t(state), sym);
+            ASSERT_EQ((packed == CombTable<uint16_t>::Dead) ? CompiledAutomaton::Dead : packed, to);
+        }
+    }
+
+    //
+    // 2^16 - 1 is Dead, so 2^16 states do not fit
+    //
+
+    auto blowup = CompileRegexp("ab+*a.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.ab+.", { 'a', 'b' });
+    ASSERT_GT(blowup.StatesCount(), 0xFFFFu);
+    ASSERT_THROW(CombTable<uint16_t>::FromCompiled(blowup), std::runtime_error);
+    ASSERT_EQ(SolveTable(CombTable<uint32_t>::FromCompiled(blowup), "abababbbbbbbbbbbbbaaa"),
+              SolveTask13(blowup, "abababbbbbbbbbbbbbaaa"));
+
+    //
+    // CompiledAutomaton itself keeps 16-bit ids only while they fit
+    //
+
+    ASSERT_TRUE(automaton.IsNarrow());
+    ASSERT_FALSE(blowup.IsNarrow());
+    ASSERT_EQ(SolveTask13(blowup, "abababbbbbbbbbbbbbaaa"),
+              SolveTable(DenseTable<uint32_t>::FromCompiled(blowup), "abababbbbbbbbbbbbbaaa"));
+}
+
+TEST(TestRuns, MatchesScan)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(71);
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp)
+    {
+        auto automaton = CompileRegexp(Regexp, abc);
+        return [automaton](std::string const& Word) { return SolveTask13(automaton, EncodeRuns(Word)); };
+    });
+
+    //
+    // Matches starting and ending inside a run and on its borders
+    //
+
+    for (auto regexp : { "aa.*", "ab*.a.", "ab.*", "ab+*c.", "a*b.", "bc*.", FirstRegexp, SecondRegexp })
+    {
+        auto automaton = CompileRegexp(regexp, abc);
+
+        for (auto word : { "", "aaaaaaa", "bbbaaaaacaaaa", "aaabbbbbbbaaa", "ababab", "cccbbbbcccccc", "aabbccaabbcc" })
+        {
+            auto expected = FindLongestMatch(automaton, word);
+            auto found = FindLongestMatch(automaton, EncodeRuns(word));
+
+            ASSERT_EQ(found.has_value(), expected.has_value()) << regexp << " " << word;
+            if (!expected)
+                continue;
+
+            ASSERT_EQ(found->Begin, expected->Begin) << regexp << " " << word;
+            ASSERT_EQ(found->End, expected->End) << regexp << " " << word;
+        }
+    }
+}
+
+TEST(TestRuns, LongRuns)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    auto bounded = CompileRegexp("ab*.a.", abc);
+    ASSERT_EQ(SolveTask13(bounded, RunLengthWord{ {'a', 1}, {'b', 1000000000000}, {'a', 1} }), 1000000000002);
+
+    //
+    // Even runs of a: the orbit of a is a cycle of length 2
+    //
+
+    auto even = CompileRegexp("aa.*", abc);
+    ASSERT_EQ(SolveTask13(even, RunLengthWord{ {'a', 1000000001} }), 1000000000);
+
+    auto span = FindLongestMatch(even, RunLengthWord{ {'b', 3}, {'a', 7}, {'c', 1}, {'a', 5} });
+    ASSERT_TRUE(span.has_value());
+    ASSERT_EQ(span->Begin, 3);
+    ASSERT_EQ(span->End, 9);
+
+    //
+    // Detected in a plain word
+    //
+
+    std::string word = "c" + std::string(100001, 'a') + "bc";
+    ASSERT_TRUE(PreferRuns(word));
+
+    MatchStats stats;
+    ASSERT_EQ(SolveTask13(even, word, &stats), 100000);
+    ASSERT_LT(stats.Starts, 10);
+}
+
+TEST(TestBottomUp, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(73);
+
+    //
+    // Random regexps are small enough not to fall back, and the result
+    // is minimal already
+    //
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp)
+    {
+        BottomUpStats stats;
+        auto bottomUp = CompileRegexpBottomUp(Regexp, abc, BottomUpMaxStates, &stats);
+        EXPECT_FALSE(stats.FellBack) << Regexp;
+        EXPECT_EQ(bottomUp.StatesCount(), Minimize(bottomUp).StatesCount()) << Regexp;
+        return bottomUp;
+    });
+
+    ASSERT_THROW(CompileRegexpBottomUp("ab", abc), std::runtime_error);
+    ASSERT_THROW(CompileRegexpBottomUp("a*.", abc), std::runtime_error);
+    ASSERT_THROW(CompileRegexpBottomUp("ad+", abc), std::runtime_error);
+}
+
+TEST(TestBottomUp, Threshold)
+{
+    AlphabetType ab = { 'a', 'b' };
+    std::string blowup = "ab+*a.ab+.ab+.ab+.ab+.ab+.";
+
+    BottomUpStats stats;
+    auto bottomUp = CompileRegexpBottomUp(blowup, ab, 16, &stats);
+    ASSERT_TRUE(stats.FellBack);
+    ASSERT_EQ(SolveTask13(bottomUp, "bbabaababbb"), SolveTask13(CompileRegexp(blowup, ab), "bbabaababbb"));
+
+    //
+    // Operands are minimized before they meet: (a + b)* is a single state
+    //
+
+    auto universal = CompileRegexpBottomUp("ab+*ab+*.ab+*+", ab, 4, &stats);
+    ASSERT_FALSE(stats.FellBack);
+    ASSERT_EQ(universal.StatesCount(), 1);
+    ASSERT_EQ(stats.PeakStates, 3);
+}
+
+TEST(TestBisimulation, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(79);
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp)
+    {
+        ReductionStats stats;
+        auto reduced = CompileViaEpsRemoval(Regexp, abc, &stats);
+        EXPECT_LE(stats.StatesAfter, stats.StatesBefore) << Regexp;
+        EXPECT_LE(reduced.StatesCount(), CompileViaEpsRemoval(Regexp, abc).StatesCount()) << Regexp;
+        return reduced;
+    });
+}
+
+TEST(TestBisimulation, Reduction)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    //
+    // Both alternatives are the same: initial, after a, after ab
+    //
+
+    ReductionStats stats;
+    CompileViaEpsRemoval("ab.ab.+", abc, &stats);
+    ASSERT_GT(stats.StatesBefore, 3);
+    ASSERT_EQ(stats.StatesAfter, 3);
+    ASSERT_LT(stats.TransitionsAfter, stats.TransitionsBefore);
+
+    //
+    // Same future (forward) and same past (backward) are merged
+    //
+
+    CompileViaEpsRemoval("ac.bc.+", abc, &stats);
+    ASSERT_EQ(stats.StatesAfter, 3);
+
+    CompileViaEpsRemoval("ab.ac.+", abc, &stats);
+    ASSERT_EQ(stats.StatesAfter, 3);
+}
+
+//
+// Union of the words in reverse polish, left-deep as the dictionaries are
+//
+
+std::string LiteralUnion(std::vector<std::string> const& Words)
+{
+    std::string regexp;
+    for (size_t idx = 0; idx != Words.size(); idx++)
+    {
+        regexp += Words[idx].empty() ? "1" : std::string(1, Words[idx][0]);
+        for (size_t position = 1; position < Words[idx].length(); position++)
+            regexp += std::string(1, Words[idx][position]) + ".";
+
+        if (idx != 0)
+            regexp += "+";
+    }
+
+    return regexp;
+}
+
+TEST(TestLiterals, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(83);
+
+    for (size_t test = 0; test != 60; test++)
+    {
+        std::vector<std::string> words(1 + rng() % 30);
+        for (auto& word : words)
+        {
+            word.resize(rng() % 6);
+            for (auto& sym : word)
+                sym = "abc"[rng() % 3];
+        }
+
+        //
+        // Alone, under a star and next to a non-literal operand
+        //
+
+        auto dictionary = LiteralUnion(words);
+        for (auto const& regexp : { dictionary, dictionary + "*", dictionary + "c*.", "ab+*" + dictionary + "." })
+        {
+            auto compiled = CompileRegexp(regexp, abc);
+            auto expected = CompileRegexpBottomUp(regexp, abc);
+            ASSERT_EQ(Minimize(compiled).StatesCount(), expected.StatesCount()) << regexp;
+
+            std::string text(rng() % 40, '\0');
+            for (auto& sym : text)
+                sym = "abc"[rng() % 3];
+
+            ASSERT_EQ(SolveTask13(compiled, text), SolveTask13(expected, text)) << regexp << " " << text;
+            ASSERT_EQ(SolveNfa(CompileNfa(regexp, abc), text), SolveTask13(expected, text)) << regexp << " " << text;
+        }
+    }
+}
+
+TEST(TestLiterals, Trie)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+
+    //
+    // Root, a, ab, ac, abc, b and the finite state
+    //
+
+    auto trie = CreateTrie({ "ab", "ac", "b", "abc", "ab" });
+    ASSERT_EQ(CollectReachable(trie.Initial).size(), 7);
+    Automaton::EndUsing();
+
+    std::vector<std::string> words = { "abc", "abb", "aca", "b", "bc", "cab", "cc", "abca" };
+    ASSERT_EQ(words.size(), LiteralUnionMinWords);
+
+    auto parsed = ParseSimplified(LiteralUnion(words), abc);
+    ASSERT_EQ(CollectReachable(parsed.Initial).size(), 15);
+    Automaton::EndUsing();
+
+    //
+    // Fewer words are built as written
+    //
+
+    words.pop_back();
+    parsed = ParseSimplified(LiteralUnion(words), abc);
+    ASSERT_EQ(parsed.Initial->Name(), "+");
+    ASSERT_GT(CollectReachable(parsed.Initial).size(), 30);
+    Automaton::EndUsing();
+
+    //
+    // Symbols appended to a dictionary are not copied into its words
+    //
+
+    std::mt19937 rng(89);
+    std::vector<std::string> dictionary(2000);
+    for (auto& word : dictionary)
+    {
+        word.resize(4 + rng() % 5);
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+    }
+
+    auto regexp = LiteralUnion(dictionary);
+    size_t wordsStates = CollectReachable(ParseSimplified(regexp, abc).Initial).size();
+    Automaton::EndUsing();
+
+    for (size_t idx = 0; idx != 1000; idx++)
+        regexp += std::string(1, "abc"[idx % 3]) + ".";
+
+    parsed = ParseSimplified(regexp, abc);
+    ASSERT_LE(CollectReachable(parsed.Initial).size(), wordsStates + 2 * 1000);
+    Automaton::EndUsing();
+}
+
+TEST(TestAst, Simplifications)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    RegexpAst ast;
+
+    auto simplified = [&](std::string const& Regexp) { return ast.ToReversePolish(ast.Parse(Regexp, abc)); };
+
+    ASSERT_EQ(simplified("a**"), "a*");
+    ASSERT_EQ(simplified("aa+"), "a");
+    ASSERT_EQ(simplified("1a."), "a");
+    ASSERT_EQ(simplified("a1."), "a");
+    ASSERT_EQ(simplified("1a+*"), "a*");
+    ASSERT_EQ(simplified("a*a*."), "a*");
+    ASSERT_EQ(simplified("1a*+"), "a*");
+    ASSERT_EQ(simplified("1*"), "1");
+    ASSERT_EQ(simplified("1a+"), "a1+");
+
+    //
+    // Associative operands and reordered alternatives are one node
+    //
+
+    ASSERT_EQ(ast.Parse("ab.c.", abc), ast.Parse("abc..", abc));
+    ASSERT_EQ(ast.Parse("ab+c+", abc), ast.Parse("cb+a+", abc));
+    ASSERT_NE(ast.Parse("ab.", abc), ast.Parse("ba.", abc));
+
+    //
+    // Repeated subexpression is stored once
+    //
+
+    RegexpAst shared;
+    auto root = shared.Parse("ab.c+*ab.c+*a..ab.c+*a..", abc);
+    ASSERT_EQ(shared.ToReversePolish(root), "ab.c+*a.ab.c+*.a.");
+    ASSERT_LT(shared.Size(), shared.TreeSize(root));
+}
+
+TEST(TestAst, LongUnion)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(97);
+
+    std::vector<std::string> words(8192);
+    for (auto& word : words)
+    {
+        word.resize(6 + rng() % 6);
+        for (auto& sym : word)
+            sym = "abc"[rng() % 3];
+    }
+
+    //
+    // Left-deep chain of unions makes one union node, not one per operator
+    //
+
+    RegexpAst ast;
+    auto root = ast.Parse(LiteralUnion(words) + "*", abc);
+
+    size_t unions = 0;
+    for (RegexpAst::NodeId id = 0; id != ast.Size(); id++)
+        unions += (ast.Get(id).Type == RegexpAst::Kind::Union);
+
+    ASSERT_EQ(unions, 1);
+    ASSERT_EQ(ast.Get(root).Type, RegexpAst::Kind::Kleene);
+
+    auto automaton = CompileRegexp(LiteralUnion(words), abc);
+    ASSERT_EQ(SolveTask13(automaton, words[0]), words[0].length());
+    ASSERT_EQ(SolveTask13(automaton, words[8191]), words[8191].length());
+}
+
+TEST(TestAst, SameLanguage)
+{
+    AlphabetType abc = { 'a', 'b', 'c' };
+    std::mt19937 rng(89);
+
+    //
+    // Simplified regexp is never longer and means the same
+    //
+
+    ExpectSameLanguage(rng, [&abc](std::string const& Regexp)
+    {
+        RegexpAst ast;
+        auto simplified = ast.ToReversePolish(ast.Parse(Regexp, abc));
+        EXPECT_LE(simplified.length(), Regexp.length()) << Regexp;
+        return CompileViaEpsRemoval(simplified, abc);
+    });
+
+    ASSERT_THROW(ParseSimplified("ab", abc), std::runtime_error);
+    ASSERT_THROW(ParseSimplified("a+", abc), std::runtime_error);
+    ASSERT_THROW(ParseSimplified("ad.", abc), std::runtime_error);
+}
@@ -43,4 +43,92 @@ class TestExceptions : public ::testing::Test
 
 class TestDebug : public ::testing::Test
 {
-};
\ No newline at end of file
+};
+
+class TestSession : public ::testing::Test
+{
+};
+
+class TestBatch : public ::testing::Test
+{
+};
+
+class TestServer : public ::testing::Test
+{
+};
+
+class TestCApi : public ::testing::Test
+{
+};
+
+class TestStaticRegexp : public ::testing::Test
+{
+};
+
+class TestEmit : public ::testing::Test
+{
+};
+
+class TestDeadStates : public ::testing::Test
+{
+};
+
+class TestPrefilter : public ::testing::Test
+{
+};
+
+class TestLengthBounds : public ::testing::Test
+{
+};
+
+class TestPlanner : public ::testing::Test
+{
+};
+
+class TestBudget : public ::testing::Test
+{
+};
+
+class TestSpans : public ::testing::Test
+{
+};
+
+class TestPatternSet : public ::testing::Test
+{
+};
+
+class TestWordIndex : public ::testing::Test
+{
+};
+
+class TestDeterminize : public ::testing::Test
+{
+};
+
+class TestLayout : public ::testing::Test
+{
+};
+
+class TestTables : public ::testing::Test
+{
+};
+
+class TestRuns : public ::testing::Test
+{
+};
+
+class TestBottomUp : public ::testing::Test
+{
+};
+
+class TestBisimulation : public ::testing::Test
+{
+};
+
+class TestLiterals : public ::testing::Test
+{
+};
+
+class TestAst : public ::testing::Test
+{
+};